@@ -6,6 +6,10 @@ find_package( Eigen3 REQUIRED )
 include_directories(SYSTEM ${EIGEN3_INCLUDE_DIR})
 list(APPEND gp_LIBRARIES ${EIGEN3_LIBRARIES})
 
+# Find Threads.
+find_package( Threads REQUIRED )
+list(APPEND gp_LIBRARIES ${CMAKE_THREAD_LIBS_INIT})
+
 # Find matplotpp.
 #find_package( matplotpp REQUIRED )
 #include_directories(SYSTEM ${MATPLOTPP_INCLUDE_DIR})
@@ -33,7 +37,10 @@ include("cmake/Modules/FindGlog.cmake")
 include_directories(SYSTEM ${GLOG_INCLUDE_DIRS})
 list(APPEND gp_LIBRARIES ${GLOG_LIBRARIES})
 
-# Find Google Ceres.
-include("cmake/Modules/FindCeres.cmake")
-include_directories(SYSTEM ${CERES_INCLUDE_DIRS})
-list(APPEND gp_LIBRARIES ${CERES_LIBRARIES})
+# Find Google Ceres (optional; a built-in L-BFGS solver is used otherwise).
+if (GP_USE_CERES)
+  include("cmake/Modules/FindCeres.cmake")
+  include_directories(SYSTEM ${CERES_INCLUDE_DIRS})
+  list(APPEND gp_LIBRARIES ${CERES_LIBRARIES})
+  add_definitions(-DGP_USE_CERES)
+endif (GP_USE_CERES)
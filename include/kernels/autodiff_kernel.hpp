@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the AutoDiffKernel class template, which is derived from the Kernel
+// base class. Derived kernels write their formula once, as a templated
+// function call operator on the scalar type of the parameters:
+//
+//   template <typename T>
+//   T operator()(const VectorXd& x, const VectorXd& y, const T* params) const;
+//
+// Evaluate calls it with doubles, while Partial and Gradient call it once with
+// forward-mode Ceres Jets to get all parameter partials at the same time. The
+// number of parameters is fixed at compile time, so Jets live on the stack.
+// Derived classes are handed to Clone by copy.
+//
+// Only available when built with GP_USE_CERES.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_KERNELS_AUTODIFF_KERNEL_H
+#define GP_KERNELS_AUTODIFF_KERNEL_H
+
+#ifdef GP_USE_CERES
+
+#include "../kernels/kernel.hpp"
+
+#include <ceres/jet.h>
+
+namespace gp {
+
+  template <typename Derived, int kNumParameters>
+  class AutoDiffKernel : public Kernel {
+  public:
+    typedef ceres::Jet<double, kNumParameters> Jet;
+
+    virtual ~AutoDiffKernel() {}
+
+    // Pure virtual methods to be implemented in a derived class.
+    Kernel::Ptr Clone() const {
+      return Kernel::Ptr(new Derived(Formula()));
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y) const {
+      return Formula()(x, y, params_.data());
+    }
+
+    // Each of these costs a single evaluation on Jets.
+    double Partial(const VectorXd& x, const VectorXd& y, size_t ii) const {
+      CHECK_LT(ii, static_cast<size_t>(kNumParameters));
+      return EvaluateJet(x, y).v(ii);
+    }
+
+    void Gradient(const VectorXd& x, const VectorXd& y,
+                  VectorXd& gradient) const {
+      gradient = EvaluateJet(x, y).v;
+    }
+
+    // One evaluation on Jets per pair of points, rather than per parameter.
+    void CovarianceGradients(const std::vector<VectorXd>& points,
+                             std::vector<MatrixXd>& gradients) const {
+      PairwiseGradients(points, gradients);
+    }
+
+  protected:
+    explicit AutoDiffKernel(const VectorXd& params)
+      : Kernel(params) {
+      CHECK_EQ(params.size(), kNumParameters);
+    }
+
+  private:
+    // Evaluate with each parameter seeded with its own infinitesimal part.
+    Jet EvaluateJet(const VectorXd& x, const VectorXd& y) const {
+      Jet params[kNumParameters];
+      for (int ii = 0; ii < kNumParameters; ii++)
+        params[ii] = Jet(params_(ii), ii);
+
+      return Formula()(x, y, params);
+    }
+
+    const Derived& Formula() const {
+      return static_cast<const Derived&>(*this);
+    }
+  }; //\class AutoDiffKernel
+
+}  //\namespace gp
+
+#endif
+
+#endif
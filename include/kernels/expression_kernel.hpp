@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines kernel expressions, which compose kernels at compile time, and the
+// ExpressionKernel class, which is derived from the Kernel base class and
+// plugs any expression into the GaussianProcess. For example,
+//
+//   const Kernel::Ptr kernel = MakeKernel(
+//     Scale(2.0, Rbf(long_lengths)) + Rbf(short_lengths) * Periodic(0.5, 1.0));
+//
+// The leaves are Rbf, Matern (5/2) and Periodic, with the same formulas as
+// RbfKernel, MaternKernel and PeriodicKernel but analytic gradients, so they
+// do not need Ceres. Each leaf makes its own pass over the input dimensions.
+//
+// Every expression type E (deriving from KernelExpression<E>) provides:
+//
+//   size_t NumParameters() const;
+//   void InitialParams(double* params) const;
+//   double Evaluate(const VectorXd& x, const VectorXd& y,
+//                   const double* params) const;
+//   double Evaluate(const VectorXd& x, const VectorXd& y,
+//                   const double* params, double* gradient) const;
+//
+// The parameters of a composite are the concatenation of its operands'
+// parameters, and its gradient follows from the sum and product rules. All
+// calls are resolved statically, so an ExpressionKernel costs one virtual
+// call per pair of points no matter how deep the expression is.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_KERNELS_EXPRESSION_KERNEL_H
+#define GP_KERNELS_EXPRESSION_KERNEL_H
+
+#include "../kernels/kernel.hpp"
+
+#include <math.h>
+
+namespace gp {
+
+  // Base of all kernel expressions, for static dispatch.
+  template <typename Derived>
+  struct KernelExpression {
+    const Derived& Self() const { return static_cast<const Derived&>(*this); }
+  }; //\struct KernelExpression
+
+  // Squared exponential with one length scale per dimension, as in RbfKernel.
+  class RbfExpression : public KernelExpression<RbfExpression> {
+  public:
+    explicit RbfExpression(const VectorXd& lengths)
+      : lengths_(lengths) {}
+
+    size_t NumParameters() const { return lengths_.size(); }
+    void InitialParams(double* params) const {
+      for (size_t ii = 0; ii < NumParameters(); ii++)
+        params[ii] = lengths_(ii);
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      double sum = 0.0;
+      for (size_t ii = 0; ii < NumParameters(); ii++) {
+        const double scaled = (x(ii) - y(ii)) / params[ii];
+        sum += scaled * scaled;
+      }
+
+      return std::exp(-0.5 * sum);
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      double sum = 0.0;
+      for (size_t ii = 0; ii < NumParameters(); ii++) {
+        const double scaled = (x(ii) - y(ii)) / params[ii];
+        sum += scaled * scaled;
+        gradient[ii] = scaled * scaled / params[ii];
+      }
+
+      const double value = std::exp(-0.5 * sum);
+      for (size_t ii = 0; ii < NumParameters(); ii++)
+        gradient[ii] *= value;
+
+      return value;
+    }
+
+  private:
+    const VectorXd lengths_;
+  }; //\class RbfExpression
+
+  // Matern with smoothness 5/2 and a single length scale, as in MaternKernel.
+  class MaternExpression : public KernelExpression<MaternExpression> {
+  public:
+    explicit MaternExpression(double length)
+      : length_(length) {}
+
+    size_t NumParameters() const { return 1; }
+    void InitialParams(double* params) const { params[0] = length_; }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      const double r = std::sqrt(5.0) * (x - y).norm() / params[0];
+      return (1.0 + r + r * r / 3.0) * std::exp(-r);
+    }
+
+    // With r = sqrt(5) |x - y| / l, dk/dl = r^2 (1 + r) exp(-r) / (3 l).
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      const double r = std::sqrt(5.0) * (x - y).norm() / params[0];
+      const double decay = std::exp(-r);
+
+      gradient[0] = r * r * (1.0 + r) * decay / (3.0 * params[0]);
+      return (1.0 + r + r * r / 3.0) * decay;
+    }
+
+  private:
+    const double length_;
+  }; //\class MaternExpression
+
+  // Periodic with a length scale and a period, in that order, as in
+  // PeriodicKernel.
+  class PeriodicExpression : public KernelExpression<PeriodicExpression> {
+  public:
+    PeriodicExpression(double length, double period)
+      : length_(length), period_(period) {}
+
+    size_t NumParameters() const { return 2; }
+    void InitialParams(double* params) const {
+      params[0] = length_;
+      params[1] = period_;
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      double sum = 0.0;
+      for (size_t ii = 0; ii < x.size(); ii++) {
+        const double s = std::sin(M_PI * (x(ii) - y(ii)) / params[1]);
+        sum += s * s;
+      }
+
+      return std::exp(-2.0 * sum / (params[0] * params[0]));
+    }
+
+    // With u_i = pi (x_i - y_i) / p and S = sum_i sin^2(u_i),
+    // dk/dl = 4 k S / l^3 and dk/dp = 2 k sum_i sin(2 u_i) u_i / (p l^2).
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      const double squared_length = params[0] * params[0];
+
+      double sum = 0.0;
+      double period_sum = 0.0;
+      for (size_t ii = 0; ii < x.size(); ii++) {
+        const double u = M_PI * (x(ii) - y(ii)) / params[1];
+        const double s = std::sin(u);
+        sum += s * s;
+        period_sum += std::sin(2.0 * u) * u;
+      }
+
+      const double value = std::exp(-2.0 * sum / squared_length);
+      gradient[0] = 4.0 * value * sum / (squared_length * params[0]);
+      gradient[1] = 2.0 * value * period_sum / (params[1] * squared_length);
+      return value;
+    }
+
+  private:
+    const double length_;
+    const double period_;
+  }; //\class PeriodicExpression
+
+  // Expression times a positive scale, which comes first in the parameters.
+  template <typename E>
+  class ScaleExpression : public KernelExpression< ScaleExpression<E> > {
+  public:
+    ScaleExpression(double scale, const E& expression)
+      : scale_(scale), expression_(expression) {}
+
+    size_t NumParameters() const { return 1 + expression_.NumParameters(); }
+    void InitialParams(double* params) const {
+      params[0] = scale_;
+      expression_.InitialParams(params + 1);
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      return params[0] * expression_.Evaluate(x, y, params + 1);
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      const double value =
+        expression_.Evaluate(x, y, params + 1, gradient + 1);
+
+      gradient[0] = value;
+      for (size_t ii = 1; ii < NumParameters(); ii++)
+        gradient[ii] *= params[0];
+
+      return params[0] * value;
+    }
+
+  private:
+    const double scale_;
+    const E expression_;
+  }; //\class ScaleExpression
+
+  // Sum of two expressions.
+  template <typename A, typename B>
+  class SumExpression : public KernelExpression< SumExpression<A, B> > {
+  public:
+    SumExpression(const A& a, const B& b)
+      : a_(a), b_(b) {}
+
+    size_t NumParameters() const {
+      return a_.NumParameters() + b_.NumParameters();
+    }
+    void InitialParams(double* params) const {
+      a_.InitialParams(params);
+      b_.InitialParams(params + a_.NumParameters());
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      return a_.Evaluate(x, y, params) +
+        b_.Evaluate(x, y, params + a_.NumParameters());
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      const size_t offset = a_.NumParameters();
+      return a_.Evaluate(x, y, params, gradient) +
+        b_.Evaluate(x, y, params + offset, gradient + offset);
+    }
+
+  private:
+    const A a_;
+    const B b_;
+  }; //\class SumExpression
+
+  // Product of two expressions.
+  template <typename A, typename B>
+  class ProductExpression : public KernelExpression< ProductExpression<A, B> > {
+  public:
+    ProductExpression(const A& a, const B& b)
+      : a_(a), b_(b) {}
+
+    size_t NumParameters() const {
+      return a_.NumParameters() + b_.NumParameters();
+    }
+    void InitialParams(double* params) const {
+      a_.InitialParams(params);
+      b_.InitialParams(params + a_.NumParameters());
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params) const {
+      return a_.Evaluate(x, y, params) *
+        b_.Evaluate(x, y, params + a_.NumParameters());
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y,
+                    const double* params, double* gradient) const {
+      const size_t offset = a_.NumParameters();
+      const double a = a_.Evaluate(x, y, params, gradient);
+      const double b =
+        b_.Evaluate(x, y, params + offset, gradient + offset);
+
+      for (size_t ii = 0; ii < offset; ii++)
+        gradient[ii] *= b;
+      for (size_t ii = offset; ii < NumParameters(); ii++)
+        gradient[ii] *= a;
+
+      return a * b;
+    }
+
+  private:
+    const A a_;
+    const B b_;
+  }; //\class ProductExpression
+
+  // Building blocks.
+  inline RbfExpression Rbf(const VectorXd& lengths) {
+    return RbfExpression(lengths);
+  }
+
+  inline MaternExpression Matern(double length) {
+    return MaternExpression(length);
+  }
+
+  inline PeriodicExpression Periodic(double length, double period) {
+    return PeriodicExpression(length, period);
+  }
+
+  template <typename E>
+  ScaleExpression<E> Scale(double scale, const KernelExpression<E>& e) {
+    return ScaleExpression<E>(scale, e.Self());
+  }
+
+  template <typename A, typename B>
+  SumExpression<A, B> operator+(const KernelExpression<A>& a,
+                                const KernelExpression<B>& b) {
+    return SumExpression<A, B>(a.Self(), b.Self());
+  }
+
+  template <typename A, typename B>
+  ProductExpression<A, B> operator*(const KernelExpression<A>& a,
+                                    const KernelExpression<B>& b) {
+    return ProductExpression<A, B>(a.Self(), b.Self());
+  }
+
+  // Type-erased wrapper around an expression. Parameters start out at the
+  // values given when the expression was built.
+  template <typename E>
+  class ExpressionKernel : public Kernel {
+  public:
+    // Factory method.
+    static Kernel::Ptr Create(const KernelExpression<E>& expression) {
+      Kernel::Ptr ptr(new ExpressionKernel(expression.Self()));
+      return ptr;
+    }
+
+    // Pure virtual methods to be implemented in a derived class.
+    Kernel::Ptr Clone() const {
+      Kernel::Ptr ptr(new ExpressionKernel(*this));
+      return ptr;
+    }
+
+    double Evaluate(const VectorXd& x, const VectorXd& y) const {
+      return expression_.Evaluate(x, y, params_.data());
+    }
+
+    // Expressions compute all partials at once, so this computes the whole
+    // gradient, on the stack unless there are many parameters. Prefer
+    // Gradient or CovarianceGradients when more than one partial is needed.
+    double Partial(const VectorXd& x, const VectorXd& y, size_t ii) const {
+      CHECK_LT(ii, params_.size());
+      const size_t kMaxStackParameters = 32;
+      if (params_.size() <= kMaxStackParameters) {
+        double gradient[kMaxStackParameters];
+        expression_.Evaluate(x, y, params_.data(), gradient);
+        return gradient[ii];
+      }
+
+      VectorXd gradient;
+      Gradient(x, y, gradient);
+      return gradient(ii);
+    }
+
+    void Gradient(const VectorXd& x, const VectorXd& y,
+                  VectorXd& gradient) const {
+      gradient.resize(params_.size());
+      expression_.Evaluate(x, y, params_.data(), gradient.data());
+    }
+
+    // One evaluation of the whole gradient per pair of points, rather than
+    // one per parameter.
+    void CovarianceGradients(const std::vector<VectorXd>& points,
+                             std::vector<MatrixXd>& gradients) const {
+      PairwiseGradients(points, gradients);
+    }
+
+  private:
+    explicit ExpressionKernel(const E& expression)
+      : Kernel(InitialParams(expression)),
+        expression_(expression) {}
+
+    static VectorXd InitialParams(const E& expression) {
+      VectorXd params(expression.NumParameters());
+      expression.InitialParams(params.data());
+      return params;
+    }
+
+    const E expression_;
+  }; //\class ExpressionKernel
+
+  template <typename E>
+  Kernel::Ptr MakeKernel(const KernelExpression<E>& expression) {
+    return ExpressionKernel<E>::Create(expression);
+  }
+
+}  //\namespace gp
+
+#endif
@@ -48,7 +48,10 @@
 #include "../utils/types.hpp"
 
 #include <glog/logging.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
+#include <math.h>
 
 namespace gp {
 
@@ -62,30 +65,170 @@ namespace gp {
     virtual ~Kernel() {}
 
     // Pure virtual methods to be implemented in a derived class.
+    virtual Ptr Clone() const = 0;
     virtual double Evaluate(const VectorXd& x, const VectorXd& y) const = 0;
     virtual double Partial(const VectorXd& x, const VectorXd& y,
                            size_t ii) const = 0;
     virtual void Gradient(const VectorXd& x, const VectorXd& y,
                           VectorXd& gradient) const = 0;
 
-    // Access and reset params.
-    VectorXd& Params() { return params_; }
+    // Evaluate in single precision, e.g. for serving. By default rounds the
+    // double precision value; derived classes should override it with a
+    // native single precision expression where possible.
+    virtual float EvaluateSingle(const VectorXf& x, const VectorXf& y) const {
+      return static_cast<float>(
+        Evaluate(x.cast<double>(), y.cast<double>()));
+    }
+
+    // Second derivatives against the parameters. By default these take
+    // central differences of Partial; derived classes should override them
+    // with analytic expressions where possible.
+    virtual double SecondPartial(const VectorXd& x, const VectorXd& y,
+                                 size_t ii, size_t jj) const {
+      CHECK_LT(jj, params_.size());
+      const double kRelativeDelta = 1e-6;
+      const double delta = kRelativeDelta * std::max(1.0, std::abs(params_(jj)));
+
+      Ptr shifted = Clone();
+      shifted->Adjust(delta, jj);
+      const double above = shifted->Partial(x, y, ii);
+      shifted->Adjust(-2.0 * delta, jj);
+      const double below = shifted->Partial(x, y, ii);
+
+      return 0.5 * (above - below) / delta;
+    }
+    virtual void Hessian(const VectorXd& x, const VectorXd& y,
+                         MatrixXd& hessian) const {
+      const size_t P = params_.size();
+      hessian.resize(P, P);
+      for (size_t ii = 0; ii < P; ii++) {
+        for (size_t jj = 0; jj <= ii; jj++) {
+          hessian(ii, jj) = SecondPartial(x, y, ii, jj);
+          hessian(jj, ii) = hessian(ii, jj);
+        }
+      }
+    }
+
+    // Derivatives of the covariance of the given points against each
+    // parameter, one symmetric N x N matrix per parameter. By default calls
+    // Partial once per parameter and pair of points; derived classes whose
+    // partials share work should override it, e.g. with PairwiseGradients.
+    virtual void CovarianceGradients(const std::vector<VectorXd>& points,
+                                     std::vector<MatrixXd>& gradients) const {
+      const size_t N = points.size();
+      const size_t P = params_.size();
+      gradients.resize(P);
+      for (size_t ii = 0; ii < P; ii++) {
+        MatrixXd& dK = gradients[ii];
+        dK.resize(N, N);
+
+        for (size_t jj = 0; jj < N; jj++) {
+          dK(jj, jj) = Partial(points[jj], points[jj], ii);
+
+          for (size_t kk = 0; kk < jj; kk++) {
+            dK(jj, kk) = Partial(points[jj], points[kk], ii);
+            dK(kk, jj) = dK(jj, kk);
+          }
+        }
+      }
+    }
+
+    // Per-dimension inverse length scales, for kernels that have them.
+    // Returns whether or not they are available.
+    virtual bool InverseLengthScales(VectorXd& /* inverse_lengths */) const {
+      return false;
+    }
+
+    // Drop all input dimensions except the given ones (in increasing order),
+    // along with their parameters. Returns whether or not this kernel
+    // supports it.
+    virtual bool Restrict(const std::vector<size_t>& /* dimensions */) {
+      return false;
+    }
+
+    // Stationary kernels of the form k(x, y) = f(|S (x - y)|^2), for a
+    // diagonal scaling S, may be evaluated on points pre-scaled by S, which
+    // turns squared distances into dot products. Returns whether or not this
+    // kernel has that form, and if so the diagonal of S.
+    virtual bool DistanceScales(VectorXd& /* scales */) const {
+      return false;
+    }
+
+    // Evaluate f above at a squared scaled distance.
+    virtual double EvaluateSquaredDistance(
+      double /* squared_distance */) const {
+      LOG(FATAL) << "Kernel does not have distance scales.";
+      return 0.0;
+    }
+
+    // Access and reset params. Mutable access counts as a change, since the
+    // caller may write through it.
+    VectorXd& Params() {
+      ParamsChanged();
+      return params_;
+    }
     const VectorXd& ImmutableParams() const { return params_; }
     void Reset(const VectorXd& params) {
       CHECK_EQ(params_.size(), params.size());
       params_ = params;
+      ParamsChanged();
+    }
+    // Set params from an array of the same size. Unlike writing through
+    // Params(), only counts as a change if they actually differ, so that
+    // repeated evaluations at the same params keep anything derived from them.
+    void SetParams(const double* params) {
+      const Eigen::Map<const VectorXd> incoming(params, params_.size());
+      if (incoming == params_)
+        return;
+
+      params_ = incoming;
+      ParamsChanged();
     }
     void Adjust(double diff, size_t ii) {
       CHECK_LT(ii, params_.size());
       params_(ii) += diff;
+      ParamsChanged();
     }
 
+    // Incremented whenever the parameters (may) change, so that anything
+    // derived from them can tell when it is stale.
+    size_t ParamsVersion() const { return params_version_; }
+
   protected:
     explicit Kernel(const VectorXd& params)
-      : params_(params) {}
+      : params_(params),
+        params_version_(0) {}
+
+    // Derived classes must call this after changing 'params_' directly.
+    void ParamsChanged() { params_version_++; }
+
+    // Covariance gradients from a single call to Gradient per pair of points.
+    void PairwiseGradients(const std::vector<VectorXd>& points,
+                           std::vector<MatrixXd>& gradients) const {
+      const size_t N = points.size();
+      const size_t P = params_.size();
+      gradients.resize(P);
+      for (size_t ii = 0; ii < P; ii++)
+        gradients[ii].resize(N, N);
+
+      VectorXd gradient(P);
+      for (size_t jj = 0; jj < N; jj++) {
+        for (size_t kk = 0; kk <= jj; kk++) {
+          Gradient(points[jj], points[kk], gradient);
+
+          for (size_t ii = 0; ii < P; ii++) {
+            gradients[ii](jj, kk) = gradient(ii);
+            gradients[ii](kk, jj) = gradient(ii);
+          }
+        }
+      }
+    }
 
     // Parameter vector.
     VectorXd params_;
+
+  private:
+    size_t params_version_;
   }; //\class Kernel
 
 }  //\namespace gp
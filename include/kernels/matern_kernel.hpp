@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MaternKernel class, which is derived from AutoDiffKernel. This
+// is the Matern kernel with smoothness 5/2 and a single length scale l:
+// k(x, y) = (1 + sqrt(5) r + 5/3 r^2) exp(-sqrt(5) r), where r = |x - y| / l.
+// Sample paths are twice differentiable, rather than infinitely as with the
+// RBF kernel.
+//
+// Only available when built with GP_USE_CERES.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_KERNELS_MATERN_KERNEL_H
+#define GP_KERNELS_MATERN_KERNEL_H
+
+#ifdef GP_USE_CERES
+
+#include "../kernels/autodiff_kernel.hpp"
+
+#include <math.h>
+
+namespace gp {
+
+  class MaternKernel : public AutoDiffKernel<MaternKernel, 1> {
+  public:
+    // Factory method.
+    static Kernel::Ptr Create(double length);
+
+    // Kernel formula, templated on the scalar type of the parameters.
+    template <typename T>
+    T operator()(const VectorXd& x, const VectorXd& y, const T* params) const {
+      using std::exp;
+      const double kSqrt5 = std::sqrt(5.0);
+
+      const T r = (x - y).norm() / params[0];
+      return (1.0 + kSqrt5 * r + (5.0 / 3.0) * r * r) * exp(-kSqrt5 * r);
+    }
+
+  private:
+    explicit MaternKernel(double length);
+  }; //\class MaternKernel
+
+}  //\namespace gp
+
+#endif
+
+#endif
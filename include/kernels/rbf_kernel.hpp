@@ -55,11 +55,29 @@ namespace gp {
     static Kernel::Ptr Create(const VectorXd& lengths);
 
     // Pure virtual methods to be implemented in a derived class.
+    Kernel::Ptr Clone() const;
     double Evaluate(const VectorXd& x, const VectorXd& y) const;
     double Partial(const VectorXd& x, const VectorXd& y, size_t ii) const;
     void Gradient(const VectorXd& x, const VectorXd& y,
                   VectorXd& gradient) const;
 
+    // Native single precision evaluation.
+    float EvaluateSingle(const VectorXf& x, const VectorXf& y) const;
+
+    // Analytic second derivatives.
+    double SecondPartial(const VectorXd& x, const VectorXd& y,
+                         size_t ii, size_t jj) const;
+    void Hessian(const VectorXd& x, const VectorXd& y,
+                 MatrixXd& hessian) const;
+
+    // Lengths are per dimension, so irrelevant dimensions may be dropped.
+    bool InverseLengthScales(VectorXd& inverse_lengths) const;
+    bool Restrict(const std::vector<size_t>& dimensions);
+
+    // Stationary, with k = exp(-0.5 r^2) for distances scaled by inv(lengths).
+    bool DistanceScales(VectorXd& scales) const;
+    double EvaluateSquaredDistance(double squared_distance) const;
+
   private:
     explicit RbfKernel(const VectorXd& lengths);
   }; //\class RbfKernel
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ScaledPointCache class, which holds a set of points pre-scaled
+// by a stationary kernel's distance scales (see Kernel::DistanceScales), along
+// with their squared norms. The kernel between a new point and every cached
+// point then reduces to one matrix-vector product of dot products, instead of
+// a scaled difference per pair. Points are stored relative to the first one,
+// to keep the dot products well conditioned. The cache is tied to the
+// kernel's parameter version, and goes stale as soon as the parameters
+// change.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_KERNELS_SCALED_POINT_CACHE_H
+#define GP_KERNELS_SCALED_POINT_CACHE_H
+
+#include "../kernels/kernel.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <vector>
+
+namespace gp {
+
+  class ScaledPointCache {
+  public:
+    ~ScaledPointCache() {}
+    ScaledPointCache()
+      : kernel_(NULL),
+        version_(0),
+        supported_(false),
+        size_(0) {}
+
+    // Bring the cache up to date with the kernel's parameters and the given
+    // points. Points appended since the last update are scaled on their own,
+    // while a change of parameters rescales all of them. Returns whether or
+    // not the kernel has distance scales at all.
+    bool Update(const Kernel& kernel, const std::vector<VectorXd>& points) {
+      if (&kernel != kernel_ || kernel.ParamsVersion() != version_) {
+        kernel_ = &kernel;
+        version_ = kernel.ParamsVersion();
+        supported_ = kernel.DistanceScales(scales_);
+        size_ = 0;
+      }
+
+      if (!supported_)
+        return false;
+
+      // Start over if points were dropped.
+      const size_t N = points.size();
+      if (N < size_)
+        size_ = 0;
+
+      const Eigen::Index D = scales_.size();
+      if (size_ == 0) {
+        origin_ = (N > 0) ?
+          VectorXd(points.front().cwiseProduct(scales_)) : VectorXd::Zero(D);
+      }
+
+      // Grow storage geometrically, keeping the points already scaled.
+      if (points_.rows() != D) {
+        points_.resize(D, N);
+        norms_.resize(N);
+      } else if (static_cast<size_t>(points_.cols()) < N) {
+        const size_t capacity =
+          std::max(N, 2 * static_cast<size_t>(points_.cols()));
+        points_.conservativeResize(D, capacity);
+        norms_.conservativeResize(capacity);
+      }
+
+      for (size_t ii = size_; ii < N; ii++) {
+        CHECK_EQ(points[ii].size(), D);
+        points_.col(ii) = points[ii].cwiseProduct(scales_) - origin_;
+        norms_(ii) = points_.col(ii).squaredNorm();
+      }
+
+      size_ = N;
+      return true;
+    }
+
+    // Whether or not the first 'count' points are cached at the kernel's
+    // current parameters.
+    bool Current(const Kernel& kernel, size_t count) const {
+      return supported_ && &kernel == kernel_ &&
+        kernel.ParamsVersion() == version_ && count <= size_;
+    }
+
+    // Kernel between 'x' and each of the first 'values.size()' cached points.
+    // The cache must be current. 'scaled' is scratch space, and is only
+    // allocated when its size changes.
+    void Evaluate(const VectorXd& x, Eigen::Ref<VectorXd> values,
+                  VectorXd& scaled) const {
+      DCHECK(Current(*kernel_, values.size()));
+      const Eigen::Index N = values.size();
+
+      scaled = x.cwiseProduct(scales_) - origin_;
+      const double norm = scaled.squaredNorm();
+      values.noalias() = points_.leftCols(N).transpose() * scaled;
+
+      // Rounding may leave tiny negative squared distances between points
+      // that (nearly) coincide.
+      for (Eigen::Index ii = 0; ii < N; ii++) {
+        values(ii) = kernel_->EvaluateSquaredDistance(
+          std::max(0.0, norm + norms_(ii) - 2.0 * values(ii)));
+      }
+    }
+
+  private:
+    // Kernel and parameter version the cache was built for, and whether or
+    // not the kernel has distance scales.
+    const Kernel* kernel_;
+    size_t version_;
+    bool supported_;
+    VectorXd scales_;
+
+    // Scaled points (one per column, relative to 'origin_') and their squared
+    // norms. Storage may have room for more points than there are.
+    VectorXd origin_;
+    MatrixXd points_;
+    VectorXd norms_;
+    size_t size_;
+  }; //\class ScaledPointCache
+
+}  //\namespace gp
+
+#endif
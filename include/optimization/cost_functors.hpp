@@ -43,33 +43,60 @@
 #define GP_OPTIMIZATION_COST_FUNCTORS_H
 
 #include "../process/gaussian_process.hpp"
+#include "../process/multi_task_process.hpp"
 #include "../kernels/kernel.hpp"
+#include "../optimization/first_order_function.hpp"
 
-#include <ceres/ceres.h>
 #include <glog/logging.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
 #include <math.h>
 
 namespace gp {
 
   // Compute twice the negative log-likelihood of the training data of a GP
   // and the gradient against all the parameters of the kernel.
-  class TrainingLogLikelihood : public ceres::FirstOrderFunction {
+  // The factorization from the most recent call is memoized and reused when
+  // called again at exactly the same parameters (e.g. cost-only followed by
+  // cost + gradient during a line search). Points are assumed not to change
+  // over the lifetime of this object, and targets are copied.
+  // With several outputs (target vectors) over the same points, the
+  // log-likelihood is summed over outputs, which share one factorization.
+  class TrainingLogLikelihood : public FirstOrderFunction {
   public:
-    // Inputs: training points, training targets, kernel, and noise.
+    // Inputs: training points, training targets, kernel, and noise. Targets
+    // beyond the number of points are ignored. If 'refinement' is non-null,
+    // factorizes in mixed precision with those settings.
     // Optimization variables: kernel parameters.
     TrainingLogLikelihood(const PointSet& points,
                           const VectorXd* targets,
                           const Kernel::Ptr& kernel,
-                          double noise)
+                          double noise,
+                          const RefinementOptions* refinement = NULL)
+      : TrainingLogLikelihood(points, LeadingTargets(points, targets),
+                              kernel, noise, refinement) {}
+
+    // Same, with one output per column of 'targets', which has a row per
+    // training point.
+    TrainingLogLikelihood(const PointSet& points,
+                          const MatrixXd& targets,
+                          const Kernel::Ptr& kernel,
+                          double noise,
+                          const RefinementOptions* refinement = NULL)
       : points_(points),
         targets_(targets),
         kernel_(kernel),
-        noise_(noise) {
-      CHECK_NOTNULL(targets);
+        noise_(noise),
+        mixed_precision_(refinement != NULL),
+        refinement_(refinement ? *refinement : RefinementOptions()),
+        cached_logdet_(0.0) {
       CHECK_NOTNULL(points.get());
       CHECK_NOTNULL(kernel.get());
 
-      CHECK_EQ(points->size(), targets->size());
+      CHECK_EQ(points->size(), targets.rows());
+      CHECK_GE(targets.cols(), 1);
       CHECK_GE(points->size(), 1);
       CHECK_GT(noise, 0.0);
     }
@@ -78,72 +105,457 @@ namespace gp {
     // R&W, pg. 113/4, eqs. 5.8/9. For simplicity we leave off the constant.
     bool Evaluate(const double* const parameters,
                   double* cost, double* gradient) const {
-      // Update the kernel.
-      for (size_t ii = 0; ii < NumParameters(); ii++)
-        kernel_->Params()(ii) = parameters[ii];
-
-      // Create a new GP model and extract computed variables.
-      GaussianProcess gp(kernel_, noise_, points_, *targets_, points_->size());
-      const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
-      const VectorXd& regressed = gp.ImmutableRegressedTargets();
-      const MatrixXd& L = llt.matrixL();
-
-      const size_t N = points_->size();
+      // Update the kernel. Its parameter version only moves if the parameters
+      // did, so caches keyed to it survive repeated evaluations.
+      const size_t P = NumParameters();
+      kernel_->SetParams(parameters);
 
-      // Compute log det of covariance matrix.
-      double logdet = 0.0;
-      for (size_t ii = 0; ii < N; ii++)
-        logdet += std::log(L(ii, ii));
+      // Create a new GP model only if the parameters have changed since the
+      // last call, and extract computed variables.
+      if (!CachedProcess(parameters))
+        Factorize(parameters);
 
-      logdet *= 2.0;
+      const MatrixXd regressed = cached_gp_->OutputRegressedTargets();
+      const double logdet = cached_logdet_;
+      const double T = static_cast<double>(targets_.cols());
 
       // Evaluate cost. Add a log barrier so that parameters don't go negative.
       double barrier = 0.0;
       const double kBarrierScaling = 1e3;
-      for (size_t ii = 0; ii < NumParameters(); ii++)
+      for (size_t ii = 0; ii < P; ii++)
         barrier -= std::log(kBarrierScaling * parameters[ii]);
 
-      *cost = targets_->head(N).dot(regressed.head(N)) + logdet + barrier;
+      *cost = targets_.cwiseProduct(regressed).sum() + T * logdet + barrier;
 
-      // Maybe compute gradient.
+      // Maybe compute gradient. The derivatives of the covariance against
+      // all parameters are computed together, so that kernels can share work
+      // between them.
       if (gradient) {
-        MatrixXd dK(N, N);
-
-        for (size_t ii = 0; ii < NumParameters(); ii++) {
-          // Compute the derivative of covariance against the ii'th parameter.
-          for (size_t jj = 0; jj < N; jj++) {
-            dK(jj, jj) = kernel_->Partial(points_->at(jj), points_->at(jj), ii);
-
-            for (size_t kk = 0; kk < jj; kk++) {
-              dK(jj, kk) =
-                kernel_->Partial(points_->at(jj), points_->at(kk), ii);
-              dK(kk, jj) = dK(jj, kk);
-            }
-          }
+        std::vector<MatrixXd> dK;
+        kernel_->CovarianceGradients(*points_, dK);
 
+        for (size_t ii = 0; ii < P; ii++) {
           // Compute the gradient. Must add the gradient of the log barrier.
-          gradient[ii] = llt.solve(dK).trace() - 1.0 / parameters[ii] -
-            regressed.head(N).dot(dK * regressed.head(N));
+          gradient[ii] = T * cached_gp_->Solve(dK[ii]).trace() -
+            1.0 / parameters[ii] -
+            regressed.cwiseProduct(dK[ii] * regressed).sum();
         }
       }
 
       return true;
     }
 
+    // Evaluate the Hessian of the cost (including the log barrier) against
+    // the kernel parameters, reusing the memoized factorization. With
+    // A_i = inv(K) dK_i and W = inv(K) - regressed * regressed^T,
+    //   H_ij = 2 regressed^T dK_j A_i regressed - tr(A_j A_i)
+    //          + sum(W .* dK_ij) + delta_ij / params_i^2.
+    // With T outputs, the regressed terms are summed over outputs, and the
+    // trace and inv(K) terms are scaled by T.
+    // If 'fisher' is set, uses the expected Hessian (Fisher information)
+    // tr(A_j A_i) instead, which is positive semidefinite and does not need
+    // second derivatives of the kernel.
+    void Hessian(const double* const parameters, MatrixXd& hessian,
+                 bool fisher = false) const {
+      // Update the kernel, and factorize if necessary.
+      const size_t P = NumParameters();
+      kernel_->SetParams(parameters);
+
+      if (!CachedProcess(parameters))
+        Factorize(parameters);
+
+      const size_t N = points_->size();
+      const MatrixXd regressed = cached_gp_->OutputRegressedTargets();
+      const double T = static_cast<double>(targets_.cols());
+
+      // Compute A_i, along with dK_i * regressed and A_i * regressed.
+      std::vector<MatrixXd> dK;
+      kernel_->CovarianceGradients(*points_, dK);
+
+      std::vector<MatrixXd> solved(P);
+      std::vector<MatrixXd> dK_regressed(P);
+      std::vector<MatrixXd> solved_regressed(P);
+      for (size_t ii = 0; ii < P; ii++) {
+        solved[ii] = cached_gp_->Solve(dK[ii]);
+        dK_regressed[ii] = dK[ii] * regressed;
+        solved_regressed[ii] = solved[ii] * regressed;
+      }
+
+      // Terms that only need first derivatives. Note tr(A_j A_i) is the sum
+      // of A_j .* A_i^T.
+      hessian.resize(P, P);
+      for (size_t ii = 0; ii < P; ii++) {
+        for (size_t jj = 0; jj <= ii; jj++) {
+          const double trace =
+            T * solved[jj].cwiseProduct(solved[ii].transpose()).sum();
+
+          hessian(ii, jj) = fisher ? trace : 2.0 *
+            dK_regressed[jj].cwiseProduct(solved_regressed[ii]).sum() - trace;
+        }
+      }
+
+      // Second derivative terms, accumulated over all pairs using symmetry.
+      if (!fisher) {
+        MatrixXd weights =
+          T * cached_gp_->Solve(MatrixXd(MatrixXd::Identity(N, N)));
+        weights.noalias() -= regressed * regressed.transpose();
+
+        MatrixXd pair_hessian;
+        MatrixXd second = MatrixXd::Zero(P, P);
+        for (size_t jj = 0; jj < N; jj++) {
+          const VectorXd& x = points_->at(jj);
+
+          kernel_->Hessian(x, x, pair_hessian);
+          second += weights(jj, jj) * pair_hessian;
+
+          for (size_t kk = 0; kk < jj; kk++) {
+            kernel_->Hessian(x, points_->at(kk), pair_hessian);
+            second += (weights(jj, kk) + weights(kk, jj)) * pair_hessian;
+          }
+        }
+
+        hessian.triangularView<Eigen::Lower>() += second;
+      }
+
+      // Log barrier, and fill in the upper triangle.
+      for (size_t ii = 0; ii < P; ii++) {
+        hessian(ii, ii) += 1.0 / (parameters[ii] * parameters[ii]);
+
+        for (size_t jj = 0; jj < ii; jj++)
+          hessian(jj, ii) = hessian(ii, jj);
+      }
+    }
+
     // Number of parameters in the problem.
     int NumParameters() const {
       return static_cast<int>(kernel_->ImmutableParams().size());
     }
 
+    // Return the GP model from the last evaluation if it was built with
+    // exactly these parameters, otherwise NULL.
+    const GaussianProcess* CachedProcess(const double* const parameters) const {
+      if (!cached_gp_ ||
+          !std::equal(parameters, parameters + NumParameters(),
+                      cached_params_.data()))
+        return NULL;
+
+      return cached_gp_.get();
+    }
+
   private:
-    // Inputs: training points, training targets, kernel, and noise.
+    // The leading targets, one per point, as a single output.
+    static MatrixXd LeadingTargets(const PointSet& points,
+                                   const VectorXd* targets) {
+      CHECK_NOTNULL(targets);
+      CHECK_NOTNULL(points.get());
+      CHECK_LE(points->size(), targets->size());
+      return targets->head(points->size());
+    }
+
+    // Build a new GP model at the given parameters (which must already be
+    // stored in the kernel) and compute the log det of its covariance matrix.
+    void Factorize(const double* const parameters) const {
+      cached_gp_.reset(new GaussianProcess(
+        kernel_, noise_, points_, VectorXd(targets_.col(0)),
+        points_->size()));
+      if (targets_.cols() > 1)
+        cached_gp_->SetTargets(targets_);
+      cached_params_ = Eigen::Map<const VectorXd>(parameters, NumParameters());
+
+      if (mixed_precision_)
+        cached_gp_->EnableMixedPrecision(refinement_);
+
+      cached_logdet_ = cached_gp_->LogDeterminant();
+    }
+
+    // Inputs: training points, training targets (one output per column),
+    // kernel, and noise.
     // Optimization variables: kernel parameters.
     const PointSet points_;
-    const VectorXd* targets_;
+    const MatrixXd targets_;
     const Kernel::Ptr kernel_;
     const double noise_;
+
+    // Whether or not to factorize in mixed precision, and how to refine.
+    const bool mixed_precision_;
+    const RefinementOptions refinement_;
+
+    // Memoized GP model, log det of its covariance, and the parameters it
+    // was built with.
+    mutable std::unique_ptr<GaussianProcess> cached_gp_;
+    mutable VectorXd cached_params_;
+    mutable double cached_logdet_;
   }; // struct TrainingLogLikelihood
 
+  // Compute twice the negative log-likelihood of the training data of a
+  // MultiTaskProcess, and the gradient against the kernel parameters and the
+  // task covariance. The task covariance B is parameterized by its Cholesky
+  // factor L (B = L L^T), which keeps it positive semidefinite; the lower
+  // triangle of L follows the kernel parameters, column by column. Like
+  // TrainingLogLikelihood, the most recent model is memoized. Every target
+  // must be observed.
+  class MultiTaskLogLikelihood : public FirstOrderFunction {
+  public:
+    // Inputs: training points, training targets (one task per column),
+    // kernel, and noise.
+    // Optimization variables: kernel parameters and task covariance factor.
+    MultiTaskLogLikelihood(const PointSet& points,
+                           const MatrixXd& targets,
+                           const Kernel::Ptr& kernel,
+                           double noise)
+      : points_(points),
+        targets_(targets),
+        kernel_(kernel),
+        noise_(noise) {
+      CHECK_NOTNULL(points.get());
+      CHECK_NOTNULL(kernel.get());
+
+      CHECK_EQ(points->size(), targets.rows());
+      CHECK_GE(targets.cols(), 1);
+      CHECK(!targets.hasNaN()) << "Every target must be observed.";
+      CHECK_GT(noise, 0.0);
+    }
+
+    // Evaluate objective function and gradient, with a log barrier on the
+    // kernel parameters as in TrainingLogLikelihood.
+    bool Evaluate(const double* const parameters,
+                  double* cost, double* gradient) const {
+      const size_t P = NumKernelParameters();
+      kernel_->SetParams(parameters);
+
+      if (!CachedProcess(parameters))
+        Factorize(parameters);
+
+      double barrier = 0.0;
+      const double kBarrierScaling = 1e3;
+      for (size_t ii = 0; ii < P; ii++)
+        barrier -= std::log(kBarrierScaling * parameters[ii]);
+
+      *cost = cached_process_->Cost() + barrier;
+
+      if (gradient) {
+        VectorXd kernel_gradient;
+        MatrixXd task_gradient;
+        cached_process_->Gradient(kernel_gradient, task_gradient);
+
+        for (size_t ii = 0; ii < P; ii++)
+          gradient[ii] = kernel_gradient(ii) - 1.0 / parameters[ii];
+
+        // The task gradient is symmetric, so the gradient against L is twice
+        // its product with L.
+        const MatrixXd factor_gradient =
+          2.0 * task_gradient * TaskFactor(parameters);
+        const size_t T = targets_.cols();
+        size_t index = P;
+        for (size_t jj = 0; jj < T; jj++)
+          for (size_t ii = jj; ii < T; ii++)
+            gradient[index++] = factor_gradient(ii, jj);
+      }
+
+      return true;
+    }
+
+    // Number of parameters in the problem.
+    int NumParameters() const {
+      const size_t T = targets_.cols();
+      return static_cast<int>(NumKernelParameters() + T * (T + 1) / 2);
+    }
+
+    // Parameters for the kernel's current parameters and the given task
+    // covariance, which must be positive definite.
+    VectorXd Pack(const MatrixXd& task_covariance) const {
+      const size_t P = NumKernelParameters();
+      const size_t T = targets_.cols();
+      CHECK_EQ(task_covariance.rows(), T);
+      CHECK_EQ(task_covariance.cols(), T);
+
+      const Eigen::LLT<MatrixXd> llt(task_covariance);
+      CHECK_EQ(llt.info(), Eigen::Success)
+        << "Task covariance must be positive definite.";
+      const MatrixXd factor = llt.matrixL();
+
+      VectorXd parameters(NumParameters());
+      parameters.head(P) = kernel_->ImmutableParams();
+      size_t index = P;
+      for (size_t jj = 0; jj < T; jj++)
+        for (size_t ii = jj; ii < T; ii++)
+          parameters(index++) = factor(ii, jj);
+
+      return parameters;
+    }
+
+    // Task covariance, and its Cholesky factor, encoded by the parameters.
+    MatrixXd TaskCovariance(const double* const parameters) const {
+      const MatrixXd factor = TaskFactor(parameters);
+      return factor * factor.transpose();
+    }
+
+    MatrixXd TaskFactor(const double* const parameters) const {
+      const size_t T = targets_.cols();
+      MatrixXd factor = MatrixXd::Zero(T, T);
+      size_t index = NumKernelParameters();
+      for (size_t jj = 0; jj < T; jj++)
+        for (size_t ii = jj; ii < T; ii++)
+          factor(ii, jj) = parameters[index++];
+
+      return factor;
+    }
+
+    // Return the model from the last evaluation if it was built with exactly
+    // these parameters, otherwise NULL.
+    const MultiTaskProcess* CachedProcess(
+      const double* const parameters) const {
+      if (!cached_process_ ||
+          !std::equal(parameters, parameters + NumParameters(),
+                      cached_params_.data()))
+        return NULL;
+
+      return cached_process_.get();
+    }
+
+  private:
+    size_t NumKernelParameters() const {
+      return kernel_->ImmutableParams().size();
+    }
+
+    // Build a new model at the given parameters (whose kernel parameters must
+    // already be stored in the kernel).
+    void Factorize(const double* const parameters) const {
+      cached_process_.reset(new MultiTaskProcess(
+        kernel_, TaskCovariance(parameters), noise_, points_, targets_));
+      cached_params_ = Eigen::Map<const VectorXd>(parameters, NumParameters());
+    }
+
+    // Inputs: training points, training targets, kernel, and noise.
+    // Optimization variables: kernel parameters and task covariance factor.
+    const PointSet points_;
+    const MatrixXd targets_;
+    const Kernel::Ptr kernel_;
+    const double noise_;
+
+    // Memoized model, and the parameters it was built with.
+    mutable std::unique_ptr<MultiTaskProcess> cached_process_;
+    mutable VectorXd cached_params_;
+  }; // class MultiTaskLogLikelihood
+
+  // Compute twice the negative log-likelihood of a subset (minibatch) of the
+  // training data of a GP and the gradient against all the parameters of the
+  // kernel, at the kernel's current parameters. Each evaluation costs O(B^3)
+  // for a minibatch of size B. The trace term of the gradient may optionally
+  // be estimated with Hutchinson's estimator, which replaces the explicit
+  // inverse of the minibatch covariance with one solve per probe.
+  class MinibatchLogLikelihood {
+  public:
+    // Inputs: training points, training targets, kernel, noise, and number of
+    // Hutchinson probes (zero for an exact trace).
+    MinibatchLogLikelihood(const PointSet& points,
+                           const VectorXd* targets,
+                           const Kernel::Ptr& kernel,
+                           double noise, size_t num_probes = 0)
+      : points_(points),
+        targets_(targets),
+        kernel_(kernel),
+        noise_(noise),
+        num_probes_(num_probes),
+        rng_(std::random_device()()) {
+      CHECK_NOTNULL(targets);
+      CHECK_NOTNULL(points.get());
+      CHECK_NOTNULL(kernel.get());
+
+      CHECK_LE(points->size(), targets->size());
+      CHECK_GT(noise, 0.0);
+    }
+
+    // Evaluate objective function and gradient on the given minibatch. Same as
+    // TrainingLogLikelihood, but without the log barrier since stochastic
+    // learning works with the log of the kernel parameters. Returns false if
+    // the minibatch covariance could not be factorized.
+    bool Evaluate(const std::vector<size_t>& batch,
+                  double* cost, VectorXd& gradient) const {
+      const size_t B = batch.size();
+      CHECK_GE(B, 1);
+      CHECK_NOTNULL(cost);
+
+      // Compute minibatch covariance and targets.
+      covariance_.resize(B, B);
+      batch_targets_.resize(B);
+      for (size_t jj = 0; jj < B; jj++) {
+        CHECK_LT(batch[jj], points_->size());
+        const VectorXd& x = points_->at(batch[jj]);
+
+        batch_targets_(jj) = (*targets_)(batch[jj]);
+        covariance_(jj, jj) = kernel_->Evaluate(x, x) + noise_;
+
+        for (size_t kk = 0; kk < jj; kk++)
+          covariance_(jj, kk) = kernel_->Evaluate(x, points_->at(batch[kk]));
+      }
+
+      // Factorize (only the lower triangle is read) and evaluate cost.
+      llt_.compute(covariance_);
+      if (llt_.info() != Eigen::Success)
+        return false;
+
+      regressed_ = llt_.solve(batch_targets_);
+      *cost = batch_targets_.dot(regressed_) +
+        2.0 * llt_.matrixLLT().diagonal().array().log().sum();
+
+      // The gradient against the ii'th parameter is the sum over all pairs of
+      // (W - regressed * regressed^T) .* dK, where W is the inverse covariance
+      // or its Hutchinson estimate mean(inv(K) * z * z^T).
+      if (num_probes_ == 0) {
+        weights_ = llt_.solve(MatrixXd::Identity(B, B));
+      } else {
+        std::bernoulli_distribution coin(0.5);
+        probes_.resize(B, num_probes_);
+        for (size_t jj = 0; jj < B; jj++)
+          for (size_t ss = 0; ss < num_probes_; ss++)
+            probes_(jj, ss) = coin(rng_) ? 1.0 : -1.0;
+
+        weights_.noalias() = llt_.solve(probes_) * probes_.transpose();
+        weights_ /= static_cast<double>(num_probes_);
+      }
+
+      weights_.noalias() -= regressed_ * regressed_.transpose();
+
+      // Accumulate over all pairs, using symmetry of dK.
+      gradient = VectorXd::Zero(kernel_->ImmutableParams().size());
+      for (size_t jj = 0; jj < B; jj++) {
+        const VectorXd& x = points_->at(batch[jj]);
+
+        kernel_->Gradient(x, x, pair_gradient_);
+        gradient += weights_(jj, jj) * pair_gradient_;
+
+        for (size_t kk = 0; kk < jj; kk++) {
+          kernel_->Gradient(x, points_->at(batch[kk]), pair_gradient_);
+          gradient += (weights_(jj, kk) + weights_(kk, jj)) * pair_gradient_;
+        }
+      }
+
+      return true;
+    }
+
+  private:
+    // Inputs: training points, training targets, kernel, noise, and number of
+    // Hutchinson probes.
+    const PointSet points_;
+    const VectorXd* targets_;
+    const Kernel::Ptr kernel_;
+    const double noise_;
+    const size_t num_probes_;
+
+    // Random number generator for probes.
+    mutable std::default_random_engine rng_;
+
+    // Workspace, reused across evaluations.
+    mutable MatrixXd covariance_;
+    mutable Eigen::LLT<MatrixXd> llt_;
+    mutable VectorXd batch_targets_;
+    mutable VectorXd regressed_;
+    mutable MatrixXd weights_;
+    mutable MatrixXd probes_;
+    mutable VectorXd pair_gradient_;
+  }; // class MinibatchLogLikelihood
+
 } // namespace gp
 
 #endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the interfaces shared by all first order hyperparameter solvers:
+// FirstOrderFunction, an objective that can be evaluated along with its
+// gradient, and IterationCallback, which is called after every iteration and
+// may stop the solver. When built with Ceres, FirstOrderFunction is Ceres' own
+// so that the same cost functors can be handed to either solver.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_FIRST_ORDER_FUNCTION_H
+#define GP_OPTIMIZATION_FIRST_ORDER_FUNCTION_H
+
+#include "../utils/types.hpp"
+
+#ifdef GP_USE_CERES
+#include <ceres/ceres.h>
+#endif
+
+#include <stddef.h>
+
+namespace gp {
+
+#ifdef GP_USE_CERES
+  typedef ceres::FirstOrderFunction FirstOrderFunction;
+#else
+  class FirstOrderFunction {
+  public:
+    virtual ~FirstOrderFunction() {}
+
+    // Evaluate the cost and, if 'gradient' is non-null, its gradient. Returns
+    // false if the function could not be evaluated.
+    virtual bool Evaluate(const double* const parameters,
+                          double* cost, double* gradient) const = 0;
+    virtual int NumParameters() const = 0;
+  }; //\class FirstOrderFunction
+#endif
+
+  // What a solver should do after an iteration: keep going, stop with the
+  // current parameters, or stop and report failure.
+  enum CallbackReturnType { CONTINUE, TERMINATE, ABORT };
+
+  class IterationCallback {
+  public:
+    virtual ~IterationCallback() {}
+
+    // Called once at the initial parameters (iteration zero) and after every
+    // iteration, with the current cost and parameters.
+    virtual CallbackReturnType operator()(size_t iteration, double cost,
+                                          const VectorXd& parameters) = 0;
+  }; //\class IterationCallback
+
+}  //\namespace gp
+
+#endif
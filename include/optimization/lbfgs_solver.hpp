@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the LbfgsSolver class, a lightweight L-BFGS minimizer with a
+// backtracking (Armijo) line search. All workspace is allocated up front, so
+// repeated solves of the same size do not allocate. Curvature pairs may be
+// kept between solves to warm start the next one.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_LBFGS_SOLVER_H
+#define GP_OPTIMIZATION_LBFGS_SOLVER_H
+
+#include "../optimization/first_order_function.hpp"
+#include "../optimization/learning_options.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <vector>
+
+namespace gp {
+
+  class LbfgsSolver {
+  public:
+    struct Summary {
+      // Whether or not the final parameters may be used, and whether or not
+      // the solver converged (as opposed to running out of iterations or
+      // being stopped by a callback).
+      bool usable;
+      bool converged;
+
+      // Work done.
+      size_t num_iterations;
+      size_t num_cost_evaluations;
+      size_t num_gradient_evaluations;
+
+      // Cost before and after, and wall-clock time in seconds.
+      double initial_cost;
+      double final_cost;
+      double seconds;
+
+      Summary()
+        : usable(false),
+          converged(false),
+          num_iterations(0),
+          num_cost_evaluations(0),
+          num_gradient_evaluations(0),
+          initial_cost(0.0),
+          final_cost(0.0),
+          seconds(0.0) {}
+    }; //\struct Summary
+
+    ~LbfgsSolver() {}
+    explicit LbfgsSolver(size_t num_parameters, size_t rank = 15);
+
+    // Minimize the function starting from 'parameters', which are overwritten
+    // with the result. Unless 'options.warm_start' is set, curvature pairs
+    // from previous solves are forgotten first. Returns whether or not the
+    // result is usable.
+    bool Solve(const FirstOrderFunction& function,
+               const LbfgsOptions& options, size_t max_iterations,
+               const std::vector<IterationCallback*>& callbacks,
+               VectorXd& parameters, Summary* summary);
+
+    // Forget all curvature pairs.
+    void Reset() { num_pairs_ = 0; }
+
+    // Problem size and number of curvature pairs this solver can hold.
+    size_t NumParameters() const { return gradient_.size(); }
+    size_t Rank() const { return rho_.size(); }
+    size_t NumPairs() const { return num_pairs_; }
+
+  private:
+    // Compute the search direction -H * gradient with the two-loop recursion.
+    void Direction();
+
+    // Call all callbacks, returning the most severe result.
+    static CallbackReturnType Notify(
+      const std::vector<IterationCallback*>& callbacks,
+      size_t iteration, double cost, const VectorXd& parameters);
+
+    // Curvature pairs, stored as columns of a ring buffer. Column 'newest_'
+    // holds the most recent pair.
+    MatrixXd steps_;
+    MatrixXd gradient_changes_;
+    VectorXd rho_;
+    VectorXd alpha_;
+    size_t num_pairs_;
+    size_t newest_;
+
+    // Workspace.
+    VectorXd gradient_;
+    VectorXd direction_;
+    VectorXd trial_;
+    VectorXd trial_gradient_;
+  }; //\class LbfgsSolver
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Options for the various hyperparameter learning modes of a GaussianProcess,
+// and a summary of how learning went.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_LEARNING_OPTIONS_H
+#define GP_OPTIMIZATION_LEARNING_OPTIONS_H
+
+#include <stddef.h>
+
+namespace gp {
+
+  struct NoiseOptions {
+    // Range of noise variances to search.
+    double min_noise;
+    double max_noise;
+
+    // Number of log-spaced grid points, followed by number of golden section
+    // iterations to refine the best one.
+    size_t num_grid;
+    size_t num_refinements;
+
+    NoiseOptions()
+      : min_noise(1e-6),
+        max_noise(1e0),
+        num_grid(32),
+        num_refinements(20) {}
+  }; //\struct NoiseOptions
+
+  // Which L-BFGS implementation to use: the built-in one (see LbfgsSolver),
+  // or Ceres' (only available when built with GP_USE_CERES).
+  enum SolverType { BUILTIN_LBFGS, CERES_LBFGS };
+
+  // Ceres remains the default wherever it is available.
+#ifdef GP_USE_CERES
+  const SolverType kDefaultSolver = CERES_LBFGS;
+#else
+  const SolverType kDefaultSolver = BUILTIN_LBFGS;
+#endif
+
+  struct LbfgsOptions {
+    // Number of curvature pairs to remember.
+    size_t rank;
+
+    // Maximum number of backtracking steps per line search.
+    size_t max_line_search_iterations;
+
+    // Stop once the relative decrease in cost or the largest gradient entry
+    // gets this small.
+    double function_tolerance;
+    double gradient_tolerance;
+
+    // Whether or not to start from the curvature pairs remembered from the
+    // previous solve (rather than steepest descent).
+    bool warm_start;
+
+    LbfgsOptions()
+      : rank(15),
+        max_line_search_iterations(50),
+        function_tolerance(1e-6),
+        gradient_tolerance(1e-10),
+        warm_start(false) {}
+  }; //\struct LbfgsOptions
+
+  struct LearningOptions {
+    // Solver, and maximum number of solver iterations.
+    SolverType solver;
+    LbfgsOptions lbfgs;
+    size_t max_iterations;
+
+    // Wall-clock budget in seconds, or non-positive for no budget. The budget
+    // is checked between iterations, so it may be overrun by one iteration.
+    double max_seconds;
+
+    // Whether or not to also choose the noise variance. Kernel optimization
+    // alternates with noise sweeps at the learned kernel parameters, for at
+    // most 'max_noise_rounds' sweeps, until a sweep changes the noise
+    // variance by less than a factor of 1 + 'noise_tolerance'. The iteration
+    // limit applies to each kernel optimization, and the time budget to all
+    // of them together.
+    bool learn_noise;
+    NoiseOptions noise;
+    size_t max_noise_rounds;
+    double noise_tolerance;
+
+    LearningOptions()
+      : solver(kDefaultSolver),
+        max_iterations(100),
+        max_seconds(0.0),
+        learn_noise(false),
+        max_noise_rounds(5),
+        noise_tolerance(1e-2) {}
+  }; //\struct LearningOptions
+
+  struct NewtonOptions {
+    // Maximum number of iterations. Each iteration costs one factorization.
+    size_t max_iterations;
+
+    // Initial and maximum trust region radius, measured relative to the
+    // kernel parameters (i.e. in the norm ||step ./ params||).
+    double initial_radius;
+    double max_radius;
+
+    // Stop once the (relatively scaled) gradient or the relative change in
+    // cost gets this small.
+    double gradient_tolerance;
+    double function_tolerance;
+
+    // Whether to use the Fisher information instead of the exact Hessian.
+    bool fisher;
+
+    NewtonOptions()
+      : max_iterations(50),
+        initial_radius(0.5),
+        max_radius(4.0),
+        gradient_tolerance(1e-6),
+        function_tolerance(1e-10),
+        fisher(false) {}
+  }; //\struct NewtonOptions
+
+  struct LearningSummary {
+    // Whether or not new hyperparameters were installed, and whether or not
+    // learning was cut short by the time budget.
+    bool success;
+    bool deadline_reached;
+
+    // Work done by the solver.
+    size_t num_iterations;
+    size_t num_cost_evaluations;
+    size_t num_gradient_evaluations;
+
+    // Cost (twice the negative log-likelihood plus log barrier) before and
+    // after learning, and total wall-clock time in seconds.
+    double initial_cost;
+    double final_cost;
+    double seconds;
+
+    // Improvement in (log barrier regularized) log-likelihood.
+    double LogLikelihoodImprovement() const {
+      return 0.5 * (initial_cost - final_cost);
+    }
+
+    LearningSummary()
+      : success(false),
+        deadline_reached(false),
+        num_iterations(0),
+        num_cost_evaluations(0),
+        num_gradient_evaluations(0),
+        initial_cost(0.0),
+        final_cost(0.0),
+        seconds(0.0) {}
+  }; //\struct LearningSummary
+
+  // How to draw initial kernel parameters for multi-start learning. Both
+  // schemes sample uniformly in log space; Latin hypercube sampling also
+  // stratifies each parameter so that starts cover its whole range.
+  enum StartSampling { LOG_UNIFORM, LATIN_HYPERCUBE };
+
+  struct MultiStartOptions {
+    // Number of independent optimizations, and the maximum number of threads
+    // to run them on (zero means one thread per start).
+    size_t num_starts;
+    size_t num_threads;
+
+    // Range from which to draw each initial kernel parameter.
+    StartSampling sampling;
+    double min_param;
+    double max_param;
+
+    // Whether or not to use the kernel's current parameters as one start.
+    bool include_current;
+
+    // Early cancellation. After 'min_iterations' iterations, a start is
+    // abandoned if its cost exceeds the best cost of any start by more than
+    // 'cancel_margin'. Set 'cancel_margin' to a non-positive value to disable.
+    double cancel_margin;
+    size_t min_iterations;
+
+    // Solver used for every start, and maximum number of solver iterations
+    // per start. Curvature pairs are never shared between starts.
+    SolverType solver;
+    LbfgsOptions lbfgs;
+    size_t max_iterations;
+
+    MultiStartOptions()
+      : num_starts(8),
+        num_threads(0),
+        sampling(LATIN_HYPERCUBE),
+        min_param(1e-2),
+        max_param(1e1),
+        include_current(true),
+        cancel_margin(0.0),
+        min_iterations(10),
+        solver(kDefaultSolver),
+        max_iterations(100) {}
+  }; //\struct MultiStartOptions
+
+  // First-order update rules for stochastic optimization.
+  enum UpdateRule { SGD, ADAM };
+
+  struct StepOptions {
+    // Update rule and base learning rate. The learning rate at step t is
+    // 'learning_rate / (1 + decay * t)'.
+    UpdateRule rule;
+    double learning_rate;
+    double decay;
+
+    // Momentum coefficient for SGD (zero for plain gradient descent).
+    double momentum;
+
+    // Moment decay rates and regularizer for Adam.
+    double beta1;
+    double beta2;
+    double epsilon;
+
+    StepOptions()
+      : rule(ADAM),
+        learning_rate(0.05),
+        decay(0.0),
+        momentum(0.0),
+        beta1(0.9),
+        beta2(0.999),
+        epsilon(1e-8) {}
+  }; //\struct StepOptions
+
+  struct StochasticOptions {
+    // Number of training points per minibatch, and number of minibatches.
+    size_t batch_size;
+    size_t num_iterations;
+
+    // Number of Rademacher probes for Hutchinson trace estimation. Zero means
+    // the trace is computed exactly from the minibatch factorization.
+    size_t num_probes;
+
+    // Update rule applied to the log of the kernel parameters.
+    StepOptions step;
+
+    StochasticOptions()
+      : batch_size(256),
+        num_iterations(200),
+        num_probes(0) {}
+  }; //\struct StochasticOptions
+
+  struct OnlineOptions {
+    // Number of most recent training points used to estimate the gradient,
+    // and number of steps to take after each call to Add.
+    size_t window_size;
+    size_t steps_per_add;
+
+    // Number of Hutchinson probes (zero for an exact trace).
+    size_t num_probes;
+
+    // Largest change in any log kernel parameter that is tolerated before the
+    // adapted parameters are installed and the GP is refactorized.
+    double max_drift;
+
+    // Update rule applied to the log of the kernel parameters.
+    StepOptions step;
+
+    OnlineOptions()
+      : window_size(64),
+        steps_per_add(1),
+        num_probes(0),
+        max_drift(0.1) {
+      step.learning_rate = 0.01;
+    }
+  }; //\struct OnlineOptions
+
+  struct PruningOptions {
+    // A dimension is pruned when its inverse length scale times the spread of
+    // the training points along it falls below this tolerance, i.e. when it
+    // changes no training covariance by more than a factor of
+    // exp(-0.5 tolerance^2).
+    double tolerance;
+
+    PruningOptions()
+      : tolerance(1e-2) {}
+  }; //\struct PruningOptions
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StochasticOptimizer class, which applies SGD (with momentum) or
+// Adam updates to a parameter vector given noisy gradient estimates.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_STOCHASTIC_OPTIMIZER_H
+#define GP_OPTIMIZATION_STOCHASTIC_OPTIMIZER_H
+
+#include "../optimization/learning_options.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+
+namespace gp {
+
+  class StochasticOptimizer {
+  public:
+    ~StochasticOptimizer() {}
+    explicit StochasticOptimizer(const StepOptions& options,
+                                 size_t dimension);
+
+    // Take one step from 'x' against the given gradient.
+    void Step(const Eigen::Ref<const VectorXd>& gradient,
+              Eigen::Ref<VectorXd> x);
+
+    // Clear moment estimates and the step count.
+    void Reset();
+
+    // Change the dimension. Moment estimates of existing coordinates are
+    // kept, and those of new coordinates start at zero.
+    void Resize(size_t dimension);
+
+    // Update rule, current learning rate, and number of steps taken.
+    const StepOptions& Options() const { return options_; }
+    double LearningRate() const;
+    size_t NumSteps() const { return num_steps_; }
+
+  private:
+    // Update rule and learning rate schedule.
+    const StepOptions options_;
+
+    // Number of steps taken so far.
+    size_t num_steps_;
+
+    // First and second moment estimates. For SGD the first moment is the
+    // momentum (velocity) term and the second is unused.
+    VectorXd first_moment_;
+    VectorXd second_moment_;
+  }; //\class StochasticOptimizer
+
+}  //\namespace gp
+
+#endif
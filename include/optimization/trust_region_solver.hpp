@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the TrustRegionSolver class, which minimizes a
+// TrainingLogLikelihood with a trust region Newton method. Each iteration
+// costs a single factorization (plus a Hessian that reuses it), and the
+// method typically converges in far fewer iterations than L-BFGS when there
+// are only a few kernel parameters. The trust region is measured relative to
+// the current parameters, which keeps poorly scaled (e.g. ARD) kernels well
+// conditioned.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_OPTIMIZATION_TRUST_REGION_SOLVER_H
+#define GP_OPTIMIZATION_TRUST_REGION_SOLVER_H
+
+#include "../optimization/cost_functors.hpp"
+#include "../optimization/learning_options.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+
+namespace gp {
+
+  class TrustRegionSolver {
+  public:
+    ~TrustRegionSolver() {}
+    explicit TrustRegionSolver(const NewtonOptions& options);
+
+    // Minimize the cost starting from 'parameters', which are overwritten
+    // with the result. Returns false if the cost could not be evaluated at
+    // the initial parameters. Optionally reports a summary.
+    bool Solve(const TrainingLogLikelihood& cost, VectorXd& parameters,
+               LearningSummary* summary = NULL) const;
+
+    // Minimize the quadratic model gradient^T step + 0.5 step^T hessian step
+    // subject to ||step|| <= radius. The Hessian may be indefinite.
+    static void SolveSubproblem(const VectorXd& gradient,
+                                const MatrixXd& hessian, double radius,
+                                VectorXd& step);
+
+  private:
+    const NewtonOptions options_;
+  }; //\class TrustRegionSolver
+
+}  //\namespace gp
+
+#endif
@@ -44,82 +44,484 @@
 #define GP_PROCESS_GAUSSIAN_PROCESS_H
 
 #include "../kernels/kernel.hpp"
+#include "../kernels/scaled_point_cache.hpp"
+#include "../optimization/learning_options.hpp"
+#include "../process/grid_table.hpp"
+#include "../process/prediction_cache.hpp"
+#include "../process/serving_process.hpp"
+#include "../utils/mixed_precision_cholesky.hpp"
+#include "../utils/packed_symmetric_matrix.hpp"
 #include "../utils/types.hpp"
 
 #include <Eigen/Cholesky>
 #include <glog/logging.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace gp {
 
+  class LbfgsSolver;
+  class StochasticOptimizer;
+
   class GaussianProcess {
   public:
-    ~GaussianProcess() {}
+    ~GaussianProcess();
 
     // Constructors. By default picks 10% of the maximum number of points
-    // randomly within the unit box [-1, 1]^d.
+    // randomly within the unit box [-1, 1]^d. Storage is sized for the points
+    // actually present and grows as points are added, so 'max_points' is only
+    // a limit.
     explicit GaussianProcess(const Kernel::Ptr& kernel, double noise,
                              size_t dimension, size_t max_points = 100);
     explicit GaussianProcess(const Kernel::Ptr& kernel, double noise,
                              const PointSet& points,
                              size_t max_points = 100);
     explicit GaussianProcess(const Kernel::Ptr& kernel, double noise,
-                             const PointSet& points,
-                             const VectorXd& targets,
+                             const PointSet& points, VectorXd targets,
+                             size_t max_points = 100);
+
+    // Convenience overload, with points (one per column) and targets copied
+    // out of matrices, e.g. Eigen::Maps over raw arrays with any outer
+    // stride. Every point is copied into its own vector (one allocation per
+    // point) in a new PointSet, so this saves building the PointSet, not the
+    // copy; the GP keeps no reference to the matrices. To share points
+    // without copying them, pass a PointSet and move the targets in.
+    explicit GaussianProcess(const Kernel::Ptr& kernel, double noise,
+                             const Eigen::Ref<const MatrixXd>& points,
+                             const Eigen::Ref<const VectorXd>& targets,
                              size_t max_points = 100);
 
+    // Scratch vectors for Evaluate. They are sized on first use and reused
+    // after that, so evaluating with the same workspace does not allocate
+    // until the number of training points changes.
+    struct Workspace {
+      VectorXd cross;
+      VectorXd solved;
+      VectorXd projected;
+      VectorXd scaled;
+    };
+
     // Evaluate mean and variance at a point.
     void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Same, with scratch space supplied by the caller. Bypasses the
+    // prediction cache, and does not allocate once 'workspace' has been used
+    // for a GP of the same size (except in mixed precision mode, whose
+    // refined solves allocate). A workspace may not be shared by threads
+    // evaluating at the same time.
+    void Evaluate(const VectorXd& x, double& mean, double& variance,
+                  Workspace& workspace) const;
     void EvaluateTrainingPoint(size_t ii, double& mean, double& variance) const;
 
+    // Evaluate the mean of every output, and the variance they share, at a
+    // point. Bypasses the prediction cache.
+    void Evaluate(const VectorXd& x, VectorXd& means, double& variance) const;
+
+    // Evaluate mean and variance at a batch of points. Bypasses the prediction
+    // cache; large batches are split over several threads (so the kernel must
+    // be safe to evaluate concurrently).
+    void Evaluate(const std::vector<VectorXd>& points,
+                  VectorXd& means, VectorXd& variances) const;
+
+    // Bake the mean and variance on a regular grid over the box from 'lower'
+    // to 'upper', with 'resolution' nodes per dimension, into a table that
+    // answers queries by interpolation in constant time. Only for GPs with at
+    // most GridTable::kMaxDimension input dimensions. The table is a snapshot
+    // and does not follow later changes to the GP. Optionally reports a
+    // summary, including the error of the table against the exact GP at
+    // random points in the box.
+    GridTable::ConstPtr BakeGrid(const VectorXd& lower, const VectorXd& upper,
+                                 size_t resolution,
+                                 const GridOptions& options = GridOptions(),
+                                 GridSummary* summary = NULL) const;
+
+    // Copy the model into a read-only process that evaluates in the given
+    // scalar type (float or double), e.g. to serve predictions in single
+    // precision. Like a baked grid, the copy does not follow later changes to
+    // the GP.
+    template <typename Scalar>
+    typename ServingProcess<Scalar>::ConstPtr Snapshot() const;
+
     // Add new point(s). Returns whether or not points were added (points will
     // only be added until 'max_points' is reached).
     bool Add(const VectorXd& x, double target);
     bool Add(const std::vector<VectorXd>& points, const VectorXd& targets);
 
+    // Same, with points (one per column) and targets copied out of matrices,
+    // one allocation per point as above.
+    bool Add(const Eigen::Ref<const MatrixXd>& points,
+             const Eigen::Ref<const VectorXd>& targets);
+
+    // Add a new point with a target for each output. This is the only way to
+    // add points to a GP with several outputs.
+    bool Add(const VectorXd& x, const std::vector<double>& targets);
+
+    // Replace the targets with an N x T matrix of them, one output per
+    // column. All outputs share the kernel, noise, covariance, and its
+    // factorization, so T outputs cost a single factorization plus one solve
+    // with T right hand sides, and hyperparameters are learned from the
+    // log-likelihood summed over outputs. The first column becomes the
+    // targets that UpdateTargets, single-output Evaluate, BakeGrid, and
+    // Snapshot refer to. Stochastic and online hyperparameter learning, and
+    // noise learning, only support a single output.
+    void SetTargets(const Eigen::Ref<const MatrixXd>& targets);
+
     // Update the training targets in the direction of the gradient of the
     // mean squared error at the given points. Returns the mean squared error.
-    // If 'finalize' is set, computes regressed targets - only set to false if
-    // you are doing repeated updates, and be sure to set true on final update.
+    // Each batch is solved against the Cholesky factor at once, with its cross
+    // covariance computed on several threads when it is large (so the kernel
+    // must be safe to evaluate concurrently). Regressed targets are only
+    // recomputed at the next query, so repeated updates cost one solve each.
+    double UpdateTargets(const std::vector<VectorXd>& points,
+                         const std::vector<double>& targets,
+                         double step_size);
+
+    // Same, but steps the targets with SGD (with momentum) or Adam. Moment
+    // estimates are kept across calls, and across calls to Add, until the
+    // step options change.
     double UpdateTargets(const std::vector<VectorXd>& points,
                          const std::vector<double>& targets,
-                         double step_size, bool finalize = true);
+                         const StepOptions& options);
 
     // Learn kernel hyperparameters by maximizing log-likelihood of the
     // training data.
     bool LearnHyperparams();
 
+    // Same, but within an iteration and wall-clock budget. When the budget
+    // runs out, installs the best hyperparameters found so far. Optionally
+    // also chooses the noise variance, alternating with noise sweeps (see
+    // LearnNoise). The GP is left untouched unless learning succeeds.
+    // Optionally reports a summary.
+    bool LearnHyperparams(const LearningOptions& options,
+                          LearningSummary* summary = NULL);
+
+    // Learn kernel hyperparameters with a trust region Newton method on the
+    // analytic Hessian of the log-likelihood. Needs far fewer factorizations
+    // than L-BFGS when there are only a few kernel parameters. The GP is left
+    // untouched unless learning succeeds. Optionally reports a summary.
+    bool LearnHyperparams(const NewtonOptions& options,
+                          LearningSummary* summary = NULL);
+
+    // Learn kernel hyperparameters from several starting points in parallel,
+    // keeping the result with the highest log-likelihood.
+    bool LearnHyperparams(const MultiStartOptions& options);
+
+    // Learn kernel hyperparameters with stochastic gradient steps on the
+    // log-likelihood of random minibatches of the training data. The GP is
+    // left untouched unless every minibatch evaluation succeeds.
+    bool LearnHyperparams(const StochasticOptions& options);
+
+    // Learn kernel hyperparameters in a background thread, on a snapshot of
+    // the training points and targets. The returned future reports whether or
+    // not learning succeeded. New hyperparameters are installed all at once by
+    // the next call to Add, UpdateTargets, or InstallHyperparams after they
+    // are ready; points added in the meantime are replayed against the new
+    // kernel. Changing the hyperparameters or noise variance in the meantime
+    // (with LearnHyperparams, SetNoise, LearnNoise, online learning, or
+    // another call to LearnHyperparamsAsync) cancels background learning and
+    // discards its result. Never waits for a previous background optimization
+    // to finish.
+    std::future<bool> LearnHyperparamsAsync();
+
+    // Install hyperparameters learned in the background, if they are ready.
+    // Returns whether or not anything was installed.
+    bool InstallHyperparams();
+
+    // Adapt kernel hyperparameters online: after every call to Add, take a few
+    // stochastic log-likelihood gradient steps using only the most recent
+    // points. Steps accumulate in a shadow copy of the kernel, which replaces
+    // the GP's kernel parameters (with a full refactorization) only once it
+    // drifts far enough from them.
+    void EnableOnlineLearning(const OnlineOptions& options);
+    void DisableOnlineLearning();
+
+    // Set the noise variance, refactorizing. Returns whether or not the new
+    // covariance is positive definite.
+    bool SetNoise(double noise);
+
+    // Choose the noise variance that maximizes the log-likelihood of the
+    // training data, at the current kernel parameters. Searches over a
+    // NoiseSweep, so costs a single eigendecomposition plus a single
+    // refactorization regardless of how many noise variances are tried.
+    bool LearnNoise(const NoiseOptions& options = NoiseOptions());
+
+    // Drop input dimensions along which the kernel is nearly constant over the
+    // training points, e.g. once LearnHyperparams has sent their length scales
+    // off to infinity. The kernel and the training points are compacted in
+    // place, so anyone sharing them sees the reduced dimension, and the GP is
+    // refactorized. Queries and new points keep the original dimension and
+    // are projected transparently. Waits for background learning to finish.
+    // Returns the number of dimensions pruned (zero if the kernel does not
+    // support it).
+    size_t PruneDimensions(const PruningOptions& options = PruningOptions());
+
+    // Cache up to 'capacity' per-point results (cross covariance, mean, and
+    // variance) for Evaluate and UpdateTargets, so that points queried again
+    // skip the kernel evaluations and solves. Entries are invalidated whenever
+    // the training points, kernel parameters, or noise change; after
+    // UpdateTargets only the cached means are recomputed (in O(N)).
+    void EnablePredictionCache(size_t capacity);
+    void DisablePredictionCache();
+    PredictionCache::Statistics PredictionCacheStatistics() const;
+
+    // Keep only the Cholesky factor, and drop the covariance matrix. The
+    // factorization then regenerates the covariance from the kernel straight
+    // into the factor's storage, so large models hold about N^2 doubles
+    // rather than 1.5 N^2 (the dense factor plus the packed covariance), at
+    // the cost of re-evaluating the kernel on every factorization rather than
+    // once per point. ImmutableCovariance is empty while enabled.
+    void EnableCompactStorage();
+    void DisableCompactStorage();
+    bool CompactStorage() const { return compact_; }
+
+    // Factorize the covariance in single precision, and refine solves (for
+    // the regressed targets, variances, and target gradients) back to double
+    // precision accuracy, falling back to a double precision factorization
+    // when refinement stalls. Not available with compact storage, since
+    // residuals are computed from the stored covariance. The summary reports
+    // how refinement of the regressed targets went.
+    void EnableMixedPrecision(
+      const RefinementOptions& options = RefinementOptions());
+    void DisableMixedPrecision();
+    bool MixedPrecision() const { return mixed_ != NULL; }
+    RefinementSummary MixedPrecisionSummary() const {
+      Regress();
+      return refinement_;
+    }
+
+    // Solve against the covariance, i.e. compute inv(K) * b, and the log
+    // determinant of the covariance, with whichever factorization is in use.
+    VectorXd Solve(const VectorXd& b) const;
+    MatrixXd Solve(const MatrixXd& b) const;
+    double LogDeterminant() const;
+
     // Immutable accessors.
-    const MatrixXd& ImmutableCovariance() const { return covariance_; }
-    const VectorXd& ImmutableRegressedTargets() const { return regressed_; }
+    const PackedSymmetricMatrix& ImmutableCovariance() const {
+      return covariance_;
+    }
+    const VectorXd& ImmutableRegressedTargets() const {
+      Regress();
+      return regressed_;
+    }
     const VectorXd& ImmutableTargets() const { return targets_; }
+    size_t NumOutputs() const { return 1 + extra_targets_.cols(); }
+    // Targets and regressed targets of all outputs, one column per output and
+    // one row per training point.
+    MatrixXd OutputTargets() const;
+    MatrixXd OutputRegressedTargets() const;
     const ConstPointSet ImmutablePoints() const { return points_; }
-    const Eigen::LLT<MatrixXd>& ImmutableCholesky() const { return llt_; }
+    // With mixed precision, the first call after each factorization also
+    // factorizes in double precision; solves keep using whichever factor
+    // they did before.
+    const Eigen::LLT<MatrixXd>& ImmutableCholesky() const {
+      Factorize();
+      return mixed_ ? mixed_->DoubleFactorization() : llt_;
+    }
     size_t Dimension() const { return dimension_; }
+    const std::vector<size_t>& RelevantDimensions() const { return relevant_; }
+    double Noise() const { return noise_; }
 
   private:
+    // Recompute covariance, and mark the Cholesky decomposition and regressed
+    // targets stale. If 'cached' is non-null it must have been built with the
+    // current kernel parameters, and its factorization is copied instead.
+    void Refactorize(const GaussianProcess* cached = NULL);
+
+    // Bring the Cholesky decomposition, or the decomposition and the regressed
+    // targets, up to date. Mutations only mark them stale, so a burst of them
+    // costs a single factorization (or solve) at the next query. Safe to call
+    // from concurrent queries.
+    void Factorize() const;
+    void Regress() const;
+
+    // Whether or not the covariance is positive definite. Factorizes.
+    bool Factorized() const {
+      Factorize();
+      return (mixed_ ? mixed_->Info() : llt_.info()) == Eigen::Success;
+    }
+
+    // Mixed precision settings for learning, or null if disabled.
+    const RefinementOptions* Refinement() const {
+      return mixed_ ? &mixed_->Options() : NULL;
+    }
+
+    // Add a point, and a target for the first output, which must be the only
+    // one unless the caller has already stored targets for the others.
+    bool AddPoint(const VectorXd& x, double target);
+
+    // Add 'count' points, the ii'th of which is 'point(ii)', either a vector
+    // or a column expression over the caller's buffer.
+    template <typename PointAccessor>
+    bool AddBatch(size_t count, const PointAccessor& point,
+                  const Eigen::Ref<const VectorXd>& targets);
+
+    // Make room for 'size' targets and regressed targets of every output,
+    // growing geometrically up to 'max_points_'.
+    void Reserve(size_t size);
+
     // Compute the covariance and cross covariance against the training points.
     void Covariance();
-    void CrossCovariance(const VectorXd& x, VectorXd& cross) const;
+    void CrossCovariance(const VectorXd& x, Eigen::Ref<VectorXd> cross) const;
+
+    // Kernel between an already projected point and each of the first
+    // 'values.size()' training points. Uses the pre-scaled training points
+    // while they are current, and evaluates the kernel directly otherwise.
+    // 'scaled' is scratch space.
+    void KernelRow(const VectorXd& y, Eigen::Ref<VectorXd> values,
+                   VectorXd& scaled) const;
+
+    // Cross covariance of 'count' points of a batch starting at 'first', one
+    // column per point.
+    void CrossCovariance(const std::vector<VectorXd>& points,
+                         size_t first, size_t count, MatrixXd& cross) const;
+
+    // Note that the covariance and its factorization (and with them the
+    // regressed targets), or only the regressed targets, have changed.
+    void ModelChanged() {
+      generation_++;
+      regressed_generation_++;
+      stale_factorization_ = true;
+      stale_regressed_ = true;
+      scaled_points_.Update(*kernel_, *points_);
+    }
+
+    void RegressedTargetsChanged() {
+      regressed_generation_++;
+      stale_regressed_ = true;
+    }
+
+    // Mean squared error of the mean at the given points, and its gradient
+    // against the training targets.
+    double TargetGradient(const std::vector<VectorXd>& points,
+                          const std::vector<double>& targets,
+                          VectorXd& gradient) const;
+
+    // Drop pruned dimensions from an input point. Returns 'x' itself if none
+    // have been pruned, and otherwise fills and returns 'projected'.
+    const VectorXd& Project(const VectorXd& x, VectorXd& projected) const;
+
+    // Change the noise variance, leaving refactorization to the caller.
+    void SetNoiseWithoutRefactorizing(double noise);
+
+    // Take online learning steps after new points have been added. Returns
+    // whether or not the kernel parameters changed, in which case the caller
+    // must refactorize.
+    bool AdaptHyperparams();
+
+    // A background learning thread, with a flag asking it to stop, and one it
+    // raises once it is about to exit.
+    struct BackgroundLearner {
+      std::thread thread;
+      std::atomic<bool> cancel;
+      std::atomic<bool> done;
+
+      BackgroundLearner() : cancel(false), done(false) {}
+    }; //\struct BackgroundLearner
+
+    // Run by the background learning thread on a snapshot of the training
+    // data and a clone of the kernel, taken at the given hyperparameter
+    // generation.
+    void LearnInBackground(BackgroundLearner* learner, const PointSet& points,
+                           const MatrixXd& targets, const Kernel::Ptr& kernel,
+                           double noise, size_t generation,
+                           std::promise<bool> promise);
+
+    // Cancel background learning and discard any result it has handed off,
+    // because the hyperparameters or noise variance are about to change.
+    void CancelLearning();
+
+    // Join background learners that were cancelled, either all of them or
+    // only those that have already finished.
+    void JoinRetiredLearners(bool wait);
 
     // Kernel.
     const Kernel::Ptr kernel_;
 
     // Noise variance.
-    const double noise_;
+    double noise_;
 
     // Training points, targets, and regressed targets (inv(cov) * targets).
+    // Training points only keep the input dimensions listed in 'relevant_'.
+    // Targets and regressed targets may have room for more points than there
+    // are, so only their leading entries are meaningful.
     const PointSet points_;
     size_t dimension_;
+    std::vector<size_t> relevant_;
     VectorXd targets_;
-    VectorXd regressed_;
+    mutable VectorXd regressed_;
+
+    // Targets and regressed targets of any outputs after the first, one per
+    // column, laid out like the ones above. Empty for a single output.
+    MatrixXd extra_targets_;
+    mutable MatrixXd extra_regressed_;
+
+    // Training points pre-scaled for the kernel, if it has distance scales.
+    // Brought up to date whenever the model changes.
+    ScaledPointCache scaled_points_;
 
     // Maximum number of points.
     const size_t max_points_;
 
-    // Covariance matrix, with Cholesky decomposition.
-    MatrixXd covariance_;
-    Eigen::LLT<MatrixXd> llt_;
+    // Covariance matrix (lower triangle only, and empty in compact storage
+    // mode), with Cholesky decomposition, which is a dense N x N matrix. The
+    // decomposition and the regressed targets are brought up to date lazily,
+    // under the mutex.
+    bool compact_;
+    PackedSymmetricMatrix covariance_;
+    mutable Eigen::LLT<MatrixXd> llt_;
+
+    // Mixed precision factorization, or null if disabled, which replaces the
+    // Cholesky decomposition above, and how refining the regressed targets
+    // went.
+    std::unique_ptr<MixedPrecisionCholesky> mixed_;
+    mutable RefinementSummary refinement_;
+    mutable std::atomic<bool> stale_factorization_;
+    mutable std::atomic<bool> stale_regressed_;
+    mutable std::mutex factorization_mutex_;
+
+    // Kernel parameters learned in the background from a snapshot taken at
+    // the given hyperparameter generation, with the covariance of the first
+    // 'covariance.Size()' training points and its factorization.
+    struct LearnedHyperparams {
+      VectorXd params;
+      size_t generation;
+      PackedSymmetricMatrix covariance;
+      Eigen::LLT<MatrixXd> llt;
+    }; //\struct LearnedHyperparams
+
+    // Background learning thread, cancelled ones that may still be winding
+    // down, and results. The hyperparameter generation counts changes to the
+    // kernel parameters and noise variance made by anything other than
+    // installing a background result; results from an older generation are
+    // stale. The mutex guards 'learned_', the generation, and growth of
+    // 'points_' while any thread is running.
+    std::unique_ptr<BackgroundLearner> learner_;
+    std::vector< std::unique_ptr<BackgroundLearner> > retired_learners_;
+    std::mutex learner_mutex_;
+    std::atomic<bool> learned_ready_;
+    size_t hyperparams_generation_;
+    std::unique_ptr<LearnedHyperparams> learned_;
+
+    // Built-in L-BFGS workspace, kept across calls to LearnHyperparams.
+    std::unique_ptr<LbfgsSolver> lbfgs_;
+
+    // Optimizer state for UpdateTargets, grown along with the targets.
+    std::unique_ptr<StochasticOptimizer> target_optimizer_;
+
+    // Prediction cache, or null if disabled, along with the generations of
+    // the model and of the regressed targets its entries are checked against.
+    // The mutex lets const methods use the cache.
+    mutable std::unique_ptr<PredictionCache> cache_;
+    mutable std::mutex cache_mutex_;
+    size_t generation_;
+    size_t regressed_generation_;
+
+    // Online learning state, or null if disabled.
+    struct OnlineLearner;
+    std::unique_ptr<OnlineLearner> online_;
   }; //\class GaussianProcess
 
 }  //\namespace gp
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the GridTable class, which stores the mean and variance of a GP at
+// the nodes of a regular grid over a box, and answers queries in constant
+// time by multilinear or cubic (Catmull-Rom) interpolation between nodes.
+// Meant for models with at most three input dimensions. Built by
+// GaussianProcess::BakeGrid.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_GRID_TABLE_H
+#define GP_PROCESS_GRID_TABLE_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+
+namespace gp {
+
+  // How to interpolate between grid nodes.
+  enum InterpolationType { LINEAR, CUBIC };
+
+  struct GridOptions {
+    // Interpolation scheme.
+    InterpolationType interpolation;
+
+    // Number of random points in the box at which the table is checked
+    // against the exact GP when a summary is requested.
+    size_t num_check_points;
+
+    GridOptions()
+      : interpolation(LINEAR),
+        num_check_points(1000) {}
+  }; //\struct GridOptions
+
+  struct GridSummary {
+    // Number of grid nodes.
+    size_t num_nodes;
+
+    // Largest and root mean squared absolute errors of the interpolated mean
+    // and variance at the check points.
+    double max_mean_error;
+    double rms_mean_error;
+    double max_variance_error;
+    double rms_variance_error;
+
+    // Wall-clock time spent baking, and checking, in seconds.
+    double seconds;
+
+    GridSummary()
+      : num_nodes(0),
+        max_mean_error(0.0),
+        rms_mean_error(0.0),
+        max_variance_error(0.0),
+        rms_variance_error(0.0),
+        seconds(0.0) {}
+  }; //\struct GridSummary
+
+  class GridTable {
+  public:
+    typedef std::shared_ptr<const GridTable> ConstPtr;
+
+    // Largest supported number of dimensions.
+    static const size_t kMaxDimension = 3;
+
+    ~GridTable() {}
+
+    // Nodes are spaced evenly with 'resolution' nodes per dimension, from
+    // 'lower' to 'upper' inclusive (at least two, or three for cubic
+    // interpolation). Values are ordered with the first
+    // dimension varying fastest.
+    explicit GridTable(const VectorXd& lower, const VectorXd& upper,
+                       size_t resolution, InterpolationType interpolation,
+                       const VectorXd& means, const VectorXd& variances);
+
+    // Interpolate the mean and variance at a point. Points outside the box
+    // are clamped to it.
+    void Evaluate(const VectorXd& x, double& mean, double& variance) const;
+
+    // Accessors.
+    const VectorXd& Lower() const { return lower_; }
+    const VectorXd& Upper() const { return upper_; }
+    size_t Resolution() const { return resolution_; }
+    size_t NumNodes() const { return means_.size(); }
+
+  private:
+    // Box, node spacing, and strides between consecutive nodes along each
+    // dimension.
+    const VectorXd lower_;
+    const VectorXd upper_;
+    const size_t resolution_;
+    const InterpolationType interpolation_;
+    VectorXd spacing_;
+    size_t strides_[kMaxDimension];
+
+    // Values at the nodes.
+    const VectorXd means_;
+    const VectorXd variances_;
+  }; //\class GridTable
+
+}  //\namespace gp
+
+#endif
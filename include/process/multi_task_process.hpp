@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MultiTaskProcess class, an intrinsic coregionalization model
+// (ICM) over T tasks observed at the same N training points. The covariance
+// between task s at x and task t at y is B(s, t) k(x, y), for a task
+// covariance B and any Kernel k, so the covariance of all targets (stacked
+// task by task) is B (x) K + noise * I.
+//
+// When every task is observed at every point, K = U diag(l) U^T and
+// B = V diag(m) V^T give
+//   (B (x) K + noise * I)^-1 = (V (x) U) diag(1 / (m (x) l + noise)) (V (x) U)^T,
+// so solves and the log determinant cost O(N^3 + T^3) instead of
+// O((NT)^3). Missing targets (NaN) break that structure, and are handled with
+// conjugate gradients on the observed entries instead, whose matrix-vector
+// products K V B still never form the NT x NT covariance.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_MULTI_TASK_PROCESS_H
+#define GP_PROCESS_MULTI_TASK_PROCESS_H
+
+#include "../kernels/kernel.hpp"
+#include "../optimization/learning_options.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <vector>
+
+namespace gp {
+
+  struct MultiTaskOptions {
+    // Conjugate gradients (only used with missing targets) stop after this
+    // many iterations, or once the residual norm drops below this fraction of
+    // the right hand side's.
+    size_t max_cg_iterations;
+    double cg_tolerance;
+
+    MultiTaskOptions()
+      : max_cg_iterations(1000),
+        cg_tolerance(1e-10) {}
+  }; //\struct MultiTaskOptions
+
+  class MultiTaskProcess {
+  public:
+    ~MultiTaskProcess() {}
+
+    // Targets have one row per training point and one column per task, with
+    // NaN marking targets that were not observed. The task covariance must be
+    // symmetric positive semidefinite. The kernel is shared, not cloned.
+    explicit MultiTaskProcess(const Kernel::Ptr& kernel,
+                              const MatrixXd& task_covariance, double noise,
+                              const PointSet& points, const MatrixXd& targets,
+                              const MultiTaskOptions& options =
+                              MultiTaskOptions());
+
+    // Evaluate the mean and variance of every task at a point.
+    void Evaluate(const VectorXd& x, VectorXd& means,
+                  VectorXd& variances) const;
+
+    // Cost (twice the negative log-likelihood, up to a constant), and its
+    // gradient against the kernel parameters and against each entry of the
+    // task covariance. Only available when every target is observed.
+    double Cost() const;
+    void Gradient(VectorXd& kernel_gradient, MatrixXd& task_gradient) const;
+
+    // Learn the kernel parameters and task covariance by maximizing the
+    // log-likelihood with the built-in L-BFGS solver. Only available when
+    // every target is observed. The model is left untouched unless learning
+    // succeeds.
+    bool LearnHyperparams(const LbfgsOptions& options = LbfgsOptions(),
+                          size_t max_iterations = 100);
+
+    // Immutable accessors.
+    size_t NumPoints() const { return targets_.rows(); }
+    size_t NumTasks() const { return targets_.cols(); }
+    bool FullyObserved() const { return observed_.empty(); }
+    const MatrixXd& ImmutableTaskCovariance() const { return task_covariance_; }
+    const MatrixXd& ImmutableTargets() const { return targets_; }
+    const ConstPointSet ImmutablePoints() const { return points_; }
+    const Kernel::ConstPtr ImmutableKernel() const { return kernel_; }
+    double Noise() const { return noise_; }
+
+    // Regressed targets, i.e. inv(cov) * targets, laid out like the targets,
+    // and zero wherever the targets are missing.
+    const MatrixXd& ImmutableRegressedTargets() const { return regressed_; }
+
+  private:
+    // Recompute the covariance and the regressed targets, with the Kronecker
+    // eigendecomposition or with conjugate gradients as appropriate.
+    void Factorize();
+
+    // Multiply a vector over the observed targets by their covariance.
+    void Multiply(const VectorXd& v, VectorXd& product) const;
+
+    // Solve the observed covariance against 'b' with preconditioned
+    // conjugate gradients, starting from zero.
+    void Solve(const VectorXd& b, VectorXd& solution) const;
+
+    // Scatter a vector over the observed targets into an N x T matrix (zero
+    // where missing), and gather it back.
+    void Scatter(const VectorXd& v, MatrixXd& matrix) const;
+    void Gather(const MatrixXd& matrix, VectorXd& v) const;
+
+    // Kernel, task covariance, noise variance, training points, and targets.
+    const Kernel::Ptr kernel_;
+    MatrixXd task_covariance_;
+    const double noise_;
+    const PointSet points_;
+    const MatrixXd targets_;
+    const MultiTaskOptions options_;
+
+    // Column-major indices of the observed targets, or empty if all of them
+    // are observed.
+    std::vector<Eigen::Index> observed_;
+
+    // Noise-free covariance of the training points, and the regressed targets.
+    MatrixXd covariance_;
+    MatrixXd regressed_;
+
+    // Eigendecompositions of the covariance and the task covariance, and the
+    // eigenvalues of the full covariance (one row per point and one column per
+    // task). Only computed when every target is observed.
+    MatrixXd point_eigenvectors_;
+    VectorXd point_eigenvalues_;
+    MatrixXd task_eigenvectors_;
+    VectorXd task_eigenvalues_;
+    MatrixXd eigenvalues_;
+
+    // Diagonal of the observed covariance, for preconditioning.
+    VectorXd diagonal_;
+  }; //\class MultiTaskProcess
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NoiseSweep class, which eigendecomposes the noise-free
+// covariance of a set of training points once so that the log-likelihood,
+// regressed targets, and predictions can be computed cheaply for any noise
+// variance. With K = Q diag(l) Q^T, (K + s I)^-1 = Q diag(1 / (l + s)) Q^T.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_NOISE_SWEEP_H
+#define GP_PROCESS_NOISE_SWEEP_H
+
+#include "../kernels/kernel.hpp"
+#include "../optimization/learning_options.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+
+namespace gp {
+
+  class NoiseSweep {
+  public:
+    ~NoiseSweep() {}
+
+    // Uses the first 'targets.size()' training points. The kernel is cloned,
+    // so later changes to its parameters do not affect the sweep.
+    explicit NoiseSweep(const Kernel::Ptr& kernel, const PointSet& points,
+                        const VectorXd& targets);
+
+    // Cost (twice the negative log-likelihood, up to a constant) and its
+    // derivative with respect to the noise variance. O(N).
+    double Cost(double noise) const;
+    double CostDerivative(double noise) const;
+
+    // Cost at each of a grid of noise variances.
+    void Cost(const VectorXd& noises, VectorXd& costs) const;
+
+    // Noise variance with the lowest cost: best point on a log-spaced grid,
+    // refined by golden section search on log noise.
+    double BestNoise(const NoiseOptions& options) const;
+
+    // Regressed targets (inv(cov) * targets). O(N^2).
+    void RegressedTargets(double noise, VectorXd& regressed) const;
+
+    // Mean and variance at a point. O(N^2) for the first noise variance, and
+    // O(N) for each additional one.
+    void Evaluate(const VectorXd& x, double noise,
+                  double& mean, double& variance) const;
+    void Evaluate(const VectorXd& x, const VectorXd& noises,
+                  VectorXd& means, VectorXd& variances) const;
+
+    // Immutable accessors.
+    const VectorXd& ImmutableEigenvalues() const { return eigenvalues_; }
+    size_t NumPoints() const { return eigenvalues_.size(); }
+
+  private:
+    // Kernel and training points.
+    const Kernel::Ptr kernel_;
+    const PointSet points_;
+
+    // Eigendecomposition of the noise-free covariance, and targets projected
+    // onto its eigenvectors.
+    MatrixXd eigenvectors_;
+    VectorXd eigenvalues_;
+    VectorXd projected_targets_;
+  }; //\class NoiseSweep
+
+}  //\namespace gp
+
+#endif
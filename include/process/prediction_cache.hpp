@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PredictionCache class, a bounded least-recently-used cache of
+// per-query-point results keyed by the point itself. Each entry holds the
+// cross covariance of the point against the training points, and optionally
+// its predictive variance and mean. Entries are stamped with the generation
+// of the model they were computed for; the owner bumps its generation
+// whenever training points, kernel parameters, or noise change, and stale
+// entries are dropped on lookup.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_PREDICTION_CACHE_H
+#define GP_PROCESS_PREDICTION_CACHE_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <list>
+#include <unordered_map>
+
+namespace gp {
+
+  class PredictionCache {
+  public:
+    struct Entry {
+      // Cross covariance against the training points.
+      VectorXd cross;
+
+      // Predictive variance, and predictive mean along with the generation of
+      // the regressed targets it was computed from.
+      bool has_variance;
+      double variance;
+      bool has_mean;
+      double mean;
+      size_t mean_generation;
+
+      Entry()
+        : has_variance(false),
+          variance(0.0),
+          has_mean(false),
+          mean(0.0),
+          mean_generation(0) {}
+    }; //\struct Entry
+
+    struct Statistics {
+      size_t hits;
+      size_t misses;
+      size_t evictions;
+
+      // Fraction of lookups that found a valid entry.
+      double HitRate() const {
+        const size_t lookups = hits + misses;
+        return (lookups == 0) ? 0.0 :
+          static_cast<double>(hits) / static_cast<double>(lookups);
+      }
+
+      Statistics()
+        : hits(0),
+          misses(0),
+          evictions(0) {}
+    }; //\struct Statistics
+
+    ~PredictionCache() {}
+    explicit PredictionCache(size_t capacity);
+
+    // Entry for this point if there is one for the given model generation,
+    // marking it most recently used. Otherwise NULL, dropping any stale entry.
+    Entry* Find(const VectorXd& x, size_t generation);
+
+    // Fresh entry for this point and model generation, evicting the least
+    // recently used entry if full.
+    Entry* Insert(const VectorXd& x, size_t generation);
+
+    // Drop all entries (statistics are kept).
+    void Clear();
+
+    // Accessors.
+    size_t Size() const { return entries_.size(); }
+    size_t Capacity() const { return capacity_; }
+    const Statistics& ImmutableStatistics() const { return statistics_; }
+
+  private:
+    // Hash and compare points by value.
+    struct PointHash {
+      size_t operator()(const VectorXd& x) const;
+    }; //\struct PointHash
+
+    struct PointEqual {
+      bool operator()(const VectorXd& x, const VectorXd& y) const {
+        return x.size() == y.size() && x == y;
+      }
+    }; //\struct PointEqual
+
+    struct Slot {
+      Entry entry;
+      size_t generation;
+      std::list<const VectorXd*>::iterator position;
+    }; //\struct Slot
+
+    typedef std::unordered_map<VectorXd, Slot, PointHash, PointEqual> Map;
+
+    // Remove an entry.
+    void Erase(Map::iterator it);
+
+    // Maximum number of entries.
+    const size_t capacity_;
+
+    // Entries, and their keys from most to least recently used. Keys in the
+    // list point into the map, whose nodes do not move.
+    Map entries_;
+    std::list<const VectorXd*> order_;
+
+    Statistics statistics_;
+  }; //\class PredictionCache
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ServingProcess class template, a read-only copy of a trained
+// GaussianProcess that evaluates the mean and variance in the given scalar
+// type. Single precision halves the memory of the Cholesky factor and doubles
+// SIMD width in the kernel evaluations and triangular solves, at the cost of
+// accuracy on ill-conditioned covariances. Instantiated for float and double.
+// Built by GaussianProcess::Snapshot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_PROCESS_SERVING_PROCESS_H
+#define GP_PROCESS_SERVING_PROCESS_H
+
+#include "../kernels/kernel.hpp"
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace gp {
+
+  template <typename Scalar>
+  class ServingProcess {
+  public:
+    typedef std::shared_ptr<const ServingProcess> ConstPtr;
+    typedef VectorX<Scalar> Vector;
+    typedef MatrixX<Scalar> Matrix;
+
+    ~ServingProcess() {}
+
+    // Training points only keep the input dimensions listed in 'relevant'.
+    // Only the lower triangle of 'cholesky' is read.
+    explicit ServingProcess(const Kernel::ConstPtr& kernel, size_t dimension,
+                            const std::vector<size_t>& relevant,
+                            const std::vector<VectorXd>& points,
+                            const VectorXd& regressed,
+                            const MatrixXd& cholesky);
+
+    // Evaluate mean and variance at a point, or at a batch of points.
+    void Evaluate(const Vector& x, Scalar& mean, Scalar& variance) const;
+    void Evaluate(const std::vector<Vector>& points,
+                  Vector& means, Vector& variances) const;
+
+    // Accessors.
+    size_t Dimension() const { return dimension_; }
+    size_t NumPoints() const { return points_.size(); }
+
+  private:
+    // Drop pruned dimensions from an input point. Returns 'x' itself if none
+    // have been pruned, and otherwise fills and returns 'projected'.
+    const Vector& Project(const Vector& x, Vector& projected) const;
+
+    // Kernel, with parameters frozen at the time of the copy.
+    const Kernel::ConstPtr kernel_;
+
+    // Input dimension, and the dimensions the training points keep.
+    const size_t dimension_;
+    const std::vector<size_t> relevant_;
+
+    // Training points, regressed targets (inv(cov) * targets), and lower
+    // triangular Cholesky factor of the covariance.
+    std::vector<Vector> points_;
+    Vector regressed_;
+    Matrix cholesky_;
+  }; //\class ServingProcess
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MixedPrecisionCholesky class, which factorizes a symmetric
+// positive definite matrix in single precision and recovers double precision
+// solutions by iterative refinement: each step solves for the correction
+// against the single precision factor, with the residual b - K x computed in
+// double precision from the packed matrix. When the matrix is too
+// ill-conditioned for the single precision factor, or refinement stalls, it
+// falls back to a double precision factorization.
+//
+// The log determinant comes from whichever factor solves use, so without the
+// fallback it carries the single precision factor's rounding error, which
+// grows with the size and condition number of the matrix; for covariances
+// that stay in single precision it is typically accurate to about 1e-6
+// relative. Solves, on the other hand, are refined to double precision.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_MIXED_PRECISION_CHOLESKY_H
+#define GP_UTILS_MIXED_PRECISION_CHOLESKY_H
+
+#include "../utils/packed_symmetric_matrix.hpp"
+#include "../utils/types.hpp"
+
+#include <Eigen/Cholesky>
+#include <glog/logging.h>
+#include <algorithm>
+#include <mutex>
+#include <math.h>
+
+namespace gp {
+
+  struct RefinementOptions {
+    // Maximum number of refinement steps per solve.
+    size_t max_iterations;
+
+    // Stop once the backward error max|b - K x| / (|K| max|x| + max|b|)
+    // gets this small, where |K| is the largest absolute row sum.
+    double tolerance;
+
+    // Refinement has stalled once a step shrinks the backward error by less
+    // than this factor.
+    double min_reduction;
+
+    // Factorize in double precision right away when the estimated reciprocal
+    // condition number of the matrix falls below this.
+    double min_rcond;
+
+    RefinementOptions()
+      : max_iterations(10),
+        tolerance(1e-14),
+        min_reduction(0.5),
+        min_rcond(1e-5) {}
+  }; //\struct RefinementOptions
+
+  struct RefinementSummary {
+    // Number of refinement steps taken, and the backward error reached.
+    size_t num_iterations;
+    double residual;
+
+    // Whether or not the solve fell back to double precision.
+    bool fallback;
+
+    RefinementSummary()
+      : num_iterations(0),
+        residual(0.0),
+        fallback(false) {}
+  }; //\struct RefinementSummary
+
+  class MixedPrecisionCholesky {
+  public:
+    ~MixedPrecisionCholesky() {}
+    explicit MixedPrecisionCholesky(
+      const RefinementOptions& options = RefinementOptions())
+      : options_(options),
+        matrix_(NULL),
+        norm_(0.0),
+        use_double_(false),
+        has_double_(false) {}
+
+    // Factorize the given matrix, which is kept by reference for computing
+    // residuals and must not change until the next call.
+    void Compute(const PackedSymmetricMatrix& matrix) {
+      std::lock_guard<std::mutex> lock(double_mutex_);
+      matrix_ = &matrix;
+      use_double_ = false;
+      has_double_ = false;
+      double_ = Eigen::LLT<MatrixXd>();
+
+      norm_ = 0.0;
+      VectorXd row_sums = VectorXd::Zero(matrix.Size());
+      for (size_t ii = 0; ii < matrix.Size(); ii++) {
+        const Eigen::Map<const VectorXd> row = matrix.Row(ii);
+        row_sums(ii) += row.cwiseAbs().sum();
+        row_sums.head(ii) += row.head(ii).cwiseAbs();
+      }
+
+      if (matrix.Size() > 0)
+        norm_ = row_sums.maxCoeff();
+
+      single_.compute(matrix.Dense().cast<float>());
+      if (single_.info() != Eigen::Success ||
+          single_.rcond() < options_.min_rcond) {
+        FactorizeDouble();
+        use_double_ = true;
+      }
+    }
+
+    // Whether or not the factorization succeeded.
+    Eigen::ComputationInfo Info() const {
+      std::lock_guard<std::mutex> lock(double_mutex_);
+      return use_double_ ? double_.info() : single_.info();
+    }
+
+    // Solve K x = b, refining until the backward error reaches the
+    // tolerance. Optionally reports how refinement went. Safe to call
+    // concurrently.
+    template <typename Plain>
+    Plain Solve(const Plain& b, RefinementSummary* summary = NULL) const {
+      CHECK_NOTNULL(matrix_);
+      RefinementSummary local;
+      if (!summary)
+        summary = &local;
+
+      *summary = RefinementSummary();
+      Plain x, residual;
+
+      if (!UsingDouble()) {
+        x = single_.solve(b.template cast<float>()).template cast<double>();
+        double error = Residual(b, x, residual);
+
+        while (error > options_.tolerance &&
+               summary->num_iterations < options_.max_iterations) {
+          x += single_.solve(residual.template cast<float>())
+            .template cast<double>();
+          summary->num_iterations++;
+
+          const double previous = error;
+          error = Residual(b, x, residual);
+          if (error > options_.min_reduction * previous)
+            break;
+        }
+
+        summary->residual = error;
+        if (error <= options_.tolerance)
+          return x;
+      }
+
+      // Refinement did not converge, so the single precision factor is not
+      // good enough for this matrix: solve in double precision, now and
+      // until the next factorization.
+      {
+        std::lock_guard<std::mutex> lock(double_mutex_);
+        if (!has_double_)
+          FactorizeDouble();
+
+        use_double_ = true;
+      }
+
+      x = double_.solve(b);
+      summary->residual = Residual(b, x, residual);
+      summary->fallback = true;
+      return x;
+    }
+
+    // Log determinant of the matrix, from whichever factor solves use (see
+    // above for its accuracy).
+    double LogDeterminant() const {
+      if (UsingDouble())
+        return 2.0 * DoubleFactorization().matrixLLT().diagonal()
+          .array().log().sum();
+
+      return 2.0 * single_.matrixLLT().diagonal().cast<double>()
+        .array().log().sum();
+    }
+
+    // Single precision factorization.
+    const Eigen::LLT<MatrixXf>& SingleFactorization() const { return single_; }
+
+    // Double precision factorization, computed on first use and kept until
+    // the next call to Compute. Computing it does not change which factor
+    // solves use.
+    const Eigen::LLT<MatrixXd>& DoubleFactorization() const {
+      std::lock_guard<std::mutex> lock(double_mutex_);
+      if (!has_double_)
+        FactorizeDouble();
+
+      return double_;
+    }
+
+    // Whether or not solves use the double precision factorization.
+    bool UsingDouble() const {
+      std::lock_guard<std::mutex> lock(double_mutex_);
+      return use_double_;
+    }
+
+    const RefinementOptions& Options() const { return options_; }
+
+  private:
+    // Compute the residual b - K x and return the backward error.
+    template <typename Plain>
+    double Residual(const Plain& b, const Plain& x, Plain& residual) const {
+      residual = b;
+      for (size_t ii = 0; ii < matrix_->Size(); ii++) {
+        const Eigen::Map<const VectorXd> row = matrix_->Row(ii);
+        residual.row(ii).noalias() -= row.transpose() * x.topRows(ii + 1);
+        residual.topRows(ii).noalias() -= row.head(ii) * x.row(ii);
+      }
+
+      const double scale = norm_ * x.cwiseAbs().maxCoeff() +
+        b.cwiseAbs().maxCoeff();
+      return (scale > 0.0) ? residual.cwiseAbs().maxCoeff() / scale : 0.0;
+    }
+
+    // Factorize in double precision. Caller must hold the mutex.
+    void FactorizeDouble() const {
+      double_.compute(matrix_->Dense());
+      has_double_ = true;
+    }
+
+    // Refinement settings.
+    const RefinementOptions options_;
+
+    // Matrix, and its largest absolute row sum.
+    const PackedSymmetricMatrix* matrix_;
+    double norm_;
+
+    // Single precision factor, and double precision factor if needed, along
+    // with whether solves use it and whether it has been computed. The mutex
+    // guards all but the single precision factor.
+    Eigen::LLT<MatrixXf> single_;
+    mutable Eigen::LLT<MatrixXd> double_;
+    mutable bool use_double_;
+    mutable bool has_double_;
+    mutable std::mutex double_mutex_;
+  }; //\class MixedPrecisionCholesky
+
+}  //\namespace gp
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PackedSymmetricMatrix class, which stores only the lower
+// triangle of a symmetric matrix, packed row by row. Rows are contiguous and
+// each one starts where the previous one ends, so growing the matrix by a row
+// appends to storage and keeps every existing entry in place.
+//
+// Packing halves the storage of the matrix itself, but a Cholesky
+// factorization of it (through Dense() below) is still a dense N x N matrix.
+// A matrix kept alongside its factor therefore takes about 1.5 N^2 doubles,
+// against 2 N^2 when both are dense.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_PACKED_SYMMETRIC_MATRIX_H
+#define GP_UTILS_PACKED_SYMMETRIC_MATRIX_H
+
+#include "../utils/types.hpp"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <vector>
+
+namespace gp {
+
+  class PackedSymmetricMatrix {
+  public:
+    ~PackedSymmetricMatrix() {}
+    explicit PackedSymmetricMatrix(size_t size = 0)
+      : size_(0) {
+      Resize(size);
+    }
+
+    // Change the number of rows (and columns), keeping the leading block.
+    // Storage grows geometrically, so adding rows one at a time is amortized
+    // linear in the row length.
+    void Resize(size_t size) {
+      size_ = size;
+      data_.resize(Offset(size));
+    }
+
+    // Overwrite the leading block with a (not larger) matrix.
+    void SetLeadingBlock(const PackedSymmetricMatrix& block) {
+      CHECK_LE(block.size_, size_);
+      std::copy(block.data_.begin(), block.data_.end(), data_.begin());
+    }
+
+    // Entry (ii, jj), from either triangle.
+    double operator()(size_t ii, size_t jj) const {
+      return data_[Index(ii, jj)];
+    }
+
+    double& operator()(size_t ii, size_t jj) {
+      return data_[Index(ii, jj)];
+    }
+
+    // Lower triangular part of the ii'th row, i.e. its first ii + 1 entries.
+    Eigen::Map<const VectorXd> Row(size_t ii) const {
+      CHECK_LT(ii, size_);
+      return Eigen::Map<const VectorXd>(data_.data() + Offset(ii), ii + 1);
+    }
+
+    Eigen::Map<VectorXd> Row(size_t ii) {
+      CHECK_LT(ii, size_);
+      return Eigen::Map<VectorXd>(data_.data() + Offset(ii), ii + 1);
+    }
+
+    // Full dense matrix, as an expression that is evaluated straight into its
+    // destination, e.g. 'llt.compute(matrix.Dense())' fills the LLT's storage
+    // without an intermediate copy.
+    class DenseFunctor {
+    public:
+      explicit DenseFunctor(const PackedSymmetricMatrix& matrix)
+        : matrix_(&matrix) {}
+
+      double operator()(Eigen::Index row, Eigen::Index col) const {
+        return (*matrix_)(row, col);
+      }
+
+    private:
+      const PackedSymmetricMatrix* matrix_;
+    }; //\class DenseFunctor
+
+    Eigen::CwiseNullaryOp<DenseFunctor, MatrixXd> Dense() const {
+      return MatrixXd::NullaryExpr(size_, size_, DenseFunctor(*this));
+    }
+
+    // Number of rows, and number of entries allocated.
+    size_t Size() const { return size_; }
+    size_t Capacity() const { return data_.capacity(); }
+
+  private:
+    // Start of the ii'th row, and position of entry (ii, jj).
+    static size_t Offset(size_t ii) { return ii * (ii + 1) / 2; }
+    static size_t Index(size_t ii, size_t jj) {
+      return (ii >= jj) ? Offset(ii) + jj : Offset(jj) + ii;
+    }
+
+    // Number of rows, and packed lower triangle.
+    size_t size_;
+    std::vector<double> data_;
+  }; //\class PackedSymmetricMatrix
+
+}  //\namespace gp
+
+#endif
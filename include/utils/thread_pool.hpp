@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ThreadPool class, a fixed set of worker threads for splitting
+// loops whose iterations are independent. Workers are started once and kept
+// for the lifetime of the pool, so dispatching a loop only costs a wakeup.
+// One loop runs at a time; a loop started while the pool is busy (including
+// from inside another loop's iterations) runs on the calling thread alone.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GP_UTILS_THREAD_POOL_H
+#define GP_UTILS_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gp {
+
+  class ThreadPool {
+  public:
+    // Process-wide pool, with one worker per hardware thread besides the
+    // calling thread.
+    static ThreadPool& Shared() {
+      static ThreadPool pool(
+        std::max(1u, std::thread::hardware_concurrency()) - 1);
+      return pool;
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+
+      for (size_t ii = 0; ii < workers_.size(); ii++)
+        workers_[ii].join();
+    }
+
+    explicit ThreadPool(size_t num_workers)
+      : stop_(false),
+        generation_(0),
+        task_(NULL),
+        count_(0),
+        next_(0),
+        remaining_(0),
+        busy_(false) {
+      for (size_t ii = 0; ii < num_workers; ii++)
+        workers_.push_back(std::thread(&ThreadPool::Work, this));
+    }
+
+    // Number of threads a loop is spread over, including the caller.
+    size_t NumThreads() const { return workers_.size() + 1; }
+
+    // Call task(ii) for every ii in [0, count) and return once all calls are
+    // done. Iterations are handed out one at a time, to the workers and the
+    // calling thread alike.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+      bool idle = false;
+      if (count <= 1 || workers_.empty() ||
+          !busy_.compare_exchange_strong(idle, true)) {
+        for (size_t ii = 0; ii < count; ii++)
+          task(ii);
+
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        remaining_ = workers_.size();
+        generation_++;
+      }
+      wake_.notify_all();
+
+      RunIterations();
+
+      // Every worker checks in before the next loop may start.
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return remaining_ == 0; });
+        task_ = NULL;
+      }
+      busy_ = false;
+    }
+
+  private:
+    // Worker loop: wait for a new loop (or shutdown), help with it, and
+    // check in.
+    void Work() {
+      size_t seen = 0;
+      for (;;) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+          if (stop_)
+            return;
+
+          seen = generation_;
+        }
+
+        RunIterations();
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          remaining_--;
+        }
+        done_.notify_one();
+      }
+    }
+
+    // Take iterations of the current loop until there are none left.
+    void RunIterations() {
+      for (size_t ii = next_++; ii < count_; ii = next_++)
+        (*task_)(ii);
+    }
+
+    std::vector<std::thread> workers_;
+
+    // Current loop and its progress. The mutex guards everything but the
+    // next iteration counter.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_;
+    size_t generation_;
+    const std::function<void(size_t)>* task_;
+    size_t count_;
+    std::atomic<size_t> next_;
+    size_t remaining_;
+
+    // Whether or not a loop is running.
+    std::atomic<bool> busy_;
+  }; //\class ThreadPool
+
+}  //\namespace gp
+
+#endif
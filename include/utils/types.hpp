@@ -55,6 +55,14 @@ namespace gp {
 // Eigen dynamic-sized matrix and vector types.
 typedef ::Eigen::MatrixXd MatrixXd;
 typedef ::Eigen::VectorXd VectorXd;
+typedef ::Eigen::MatrixXf MatrixXf;
+typedef ::Eigen::VectorXf VectorXf;
+
+// Same, for a given scalar type.
+template <typename Scalar>
+using MatrixX = ::Eigen::Matrix<Scalar, ::Eigen::Dynamic, ::Eigen::Dynamic>;
+template <typename Scalar>
+using VectorX = ::Eigen::Matrix<Scalar, ::Eigen::Dynamic, 1>;
 
 // --------------- Internal typedefs and constants --------------- //
 
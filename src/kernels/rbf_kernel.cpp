@@ -58,10 +58,19 @@ namespace gp {
     : Kernel(lengths) {}
 
   // Pure virtual methods to be implemented in a derived class.
+  Kernel::Ptr RbfKernel::Clone() const {
+    return RbfKernel::Create(params_);
+  }
+
+  // Evaluated as a single expression, so that no temporary is allocated.
   double RbfKernel::Evaluate(const VectorXd& x, const VectorXd& y) const {
-    const VectorXd diff = x - y;
+    return std::exp(-0.5 * (x - y).cwiseQuotient(params_).squaredNorm());
+  }
 
-    return std::exp(-0.5 * diff.cwiseQuotient(params_).squaredNorm());
+  float RbfKernel::EvaluateSingle(const VectorXf& x,
+                                  const VectorXf& y) const {
+    return std::exp(
+      -0.5f * (x - y).cwiseQuotient(params_.cast<float>()).squaredNorm());
   }
 
   double RbfKernel::Partial(const VectorXd& x, const VectorXd& y,
@@ -90,4 +99,74 @@ namespace gp {
   }
 
 
+  // With a_i = (x_i - y_i)^2 / l_i^3, the first partials are k a_i, and the
+  // second partials are k (a_i a_j - delta_ij 3 (x_i - y_i)^2 / l_i^4).
+  double RbfKernel::SecondPartial(const VectorXd& x, const VectorXd& y,
+                                  size_t ii, size_t jj) const {
+    CHECK_LT(ii, params_.size());
+    CHECK_LT(jj, params_.size());
+    const VectorXd diff = x - y;
+
+    // Evaluate the kernel.
+    const double kernel =
+      std::exp(-0.5 * diff.cwiseQuotient(params_).squaredNorm());
+
+    const double a_ii = diff(ii) * diff(ii) /
+      (params_(ii) * params_(ii) * params_(ii));
+    const double a_jj = diff(jj) * diff(jj) /
+      (params_(jj) * params_(jj) * params_(jj));
+
+    if (ii == jj)
+      return kernel * (a_ii * a_ii - 3.0 * a_ii / params_(ii));
+
+    return kernel * a_ii * a_jj;
+  }
+
+  void RbfKernel::Hessian(const VectorXd& x, const VectorXd& y,
+                          MatrixXd& hessian) const {
+    const VectorXd diff = x - y;
+
+    // Evaluate the kernel.
+    const double kernel =
+      std::exp(-0.5 * diff.cwiseQuotient(params_).squaredNorm());
+
+    const VectorXd a = diff.cwiseProduct(diff).cwiseQuotient(
+      params_.cwiseProduct(params_).cwiseProduct(params_));
+
+    hessian = kernel * a * a.transpose();
+    hessian.diagonal() -= 3.0 * kernel * a.cwiseQuotient(params_);
+  }
+
+  // Lengths are per dimension, so irrelevant dimensions may be dropped.
+  bool RbfKernel::InverseLengthScales(VectorXd& inverse_lengths) const {
+    inverse_lengths = params_.cwiseInverse();
+    return true;
+  }
+
+  bool RbfKernel::Restrict(const std::vector<size_t>& dimensions) {
+    CHECK_GE(dimensions.size(), 1);
+    CHECK_LE(dimensions.size(), params_.size());
+
+    VectorXd lengths(dimensions.size());
+    for (size_t ii = 0; ii < dimensions.size(); ii++) {
+      CHECK_LT(dimensions[ii], params_.size());
+      CHECK(ii == 0 || dimensions[ii] > dimensions[ii - 1]);
+      lengths(ii) = params_(dimensions[ii]);
+    }
+
+    params_ = lengths;
+    ParamsChanged();
+    return true;
+  }
+
+  // Stationary, with k = exp(-0.5 r^2) for distances scaled by inv(lengths).
+  bool RbfKernel::DistanceScales(VectorXd& scales) const {
+    scales = params_.cwiseInverse();
+    return true;
+  }
+
+  double RbfKernel::EvaluateSquaredDistance(double squared_distance) const {
+    return std::exp(-0.5 * squared_distance);
+  }
+
 }  //\namespace gp
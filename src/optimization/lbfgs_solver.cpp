@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the LbfgsSolver class, a lightweight L-BFGS minimizer with a
+// backtracking (Armijo) line search. All workspace is allocated up front, so
+// repeated solves of the same size do not allocate. Curvature pairs may be
+// kept between solves to warm start the next one.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/lbfgs_solver.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+namespace gp {
+
+  LbfgsSolver::LbfgsSolver(size_t num_parameters, size_t rank)
+    : steps_(num_parameters, rank),
+      gradient_changes_(num_parameters, rank),
+      rho_(rank),
+      alpha_(rank),
+      num_pairs_(0),
+      newest_(0),
+      gradient_(num_parameters),
+      direction_(num_parameters),
+      trial_(num_parameters),
+      trial_gradient_(num_parameters) {
+    CHECK_GE(num_parameters, 1);
+    CHECK_GE(rank, 1);
+  }
+
+  // Minimize the function starting from 'parameters'.
+  bool LbfgsSolver::Solve(const FirstOrderFunction& function,
+                          const LbfgsOptions& options, size_t max_iterations,
+                          const std::vector<IterationCallback*>& callbacks,
+                          VectorXd& parameters, Summary* summary) {
+    CHECK_NOTNULL(summary);
+    CHECK_EQ(parameters.size(), NumParameters());
+    CHECK_EQ(static_cast<size_t>(function.NumParameters()), NumParameters());
+    CHECK_GE(options.max_line_search_iterations, 1);
+
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    *summary = Summary();
+
+    if (!options.warm_start)
+      Reset();
+
+    // Evaluate at the initial parameters.
+    double cost;
+    summary->num_cost_evaluations++;
+    summary->num_gradient_evaluations++;
+    if (!function.Evaluate(parameters.data(), &cost, gradient_.data()) ||
+        !std::isfinite(cost) || !gradient_.allFinite()) {
+      summary->seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      return false;
+    }
+
+    summary->initial_cost = cost;
+    summary->usable = true;
+
+    // Sufficient decrease parameter for the line search, and smallest
+    // acceptable curvature (relative to the pair's norms).
+    const double kArmijo = 1e-4;
+    const double kMinCurvature = 1e-10;
+
+    CallbackReturnType status = Notify(callbacks, 0, cost, parameters);
+    for (size_t ii = 1; ii <= max_iterations && status == CONTINUE; ii++) {
+      if (gradient_.lpNorm<Eigen::Infinity>() <= options.gradient_tolerance) {
+        summary->converged = true;
+        break;
+      }
+
+      // Search direction, falling back to steepest descent if the curvature
+      // pairs do not give a descent direction.
+      Direction();
+      double slope = gradient_.dot(direction_);
+      if (!(slope < 0.0)) {
+        Reset();
+        Direction();
+        slope = gradient_.dot(direction_);
+      }
+
+      // Backtracking line search on the cost alone. The gradient is only
+      // evaluated at the accepted point, so cost functors that memoize their
+      // factorization only factorize once per trial.
+      double step = 1.0;
+      double trial_cost = cost;
+      bool accepted = false;
+      for (size_t jj = 0; jj < options.max_line_search_iterations; jj++) {
+        trial_.noalias() = parameters + step * direction_;
+
+        summary->num_cost_evaluations++;
+        if (function.Evaluate(trial_.data(), &trial_cost, NULL) &&
+            std::isfinite(trial_cost) &&
+            trial_cost <= cost + kArmijo * step * slope) {
+          accepted = true;
+          break;
+        }
+
+        // Minimizer of the quadratic interpolant, safeguarded.
+        double next = 0.5 * step;
+        if (std::isfinite(trial_cost)) {
+          const double curvature = trial_cost - cost - slope * step;
+          if (curvature > 0.0)
+            next = -0.5 * slope * step * step / curvature;
+        }
+
+        step = std::min(0.5 * step, std::max(0.1 * step, next));
+      }
+
+      // No progress is possible along this direction; the current parameters
+      // are still the best seen.
+      if (!accepted)
+        break;
+
+      // The gradient at the accepted point must be usable too; otherwise stop
+      // at the last good parameters.
+      summary->num_gradient_evaluations++;
+      if (!function.Evaluate(trial_.data(), &trial_cost,
+                             trial_gradient_.data()) ||
+          !std::isfinite(trial_cost) || !trial_gradient_.allFinite())
+        break;
+
+      // Remember the curvature pair if it keeps the inverse Hessian estimate
+      // positive definite.
+      const double curvature =
+        step * direction_.dot(trial_gradient_ - gradient_);
+      if (curvature > kMinCurvature * step * direction_.norm() *
+          (trial_gradient_ - gradient_).norm()) {
+        newest_ = (newest_ + 1) % Rank();
+        steps_.col(newest_) = step * direction_;
+        gradient_changes_.col(newest_) = trial_gradient_ - gradient_;
+        rho_(newest_) = 1.0 / curvature;
+        num_pairs_ = std::min(num_pairs_ + 1, Rank());
+      }
+
+      // Step.
+      const double decrease = cost - trial_cost;
+      parameters = trial_;
+      gradient_ = trial_gradient_;
+      cost = trial_cost;
+      summary->num_iterations = ii;
+
+      status = Notify(callbacks, ii, cost, parameters);
+      if (status == CONTINUE &&
+          decrease <= options.function_tolerance * std::abs(cost)) {
+        summary->converged = true;
+        break;
+      }
+    }
+
+    summary->usable = (status != ABORT);
+    summary->final_cost = cost;
+    summary->seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    return summary->usable;
+  }
+
+  // Compute the search direction -H * gradient with the two-loop recursion.
+  // Without curvature pairs, this is steepest descent with a step of at most
+  // unit length.
+  void LbfgsSolver::Direction() {
+    direction_ = -gradient_;
+
+    if (num_pairs_ == 0) {
+      direction_ /= std::max(1.0, gradient_.norm());
+      return;
+    }
+
+    // Newest to oldest.
+    size_t index = newest_;
+    for (size_t ii = 0; ii < num_pairs_; ii++) {
+      alpha_(index) = rho_(index) * steps_.col(index).dot(direction_);
+      direction_ -= alpha_(index) * gradient_changes_.col(index);
+      index = (index + Rank() - 1) % Rank();
+    }
+
+    // Scale by the most recent estimate of the inverse Hessian's magnitude.
+    direction_ /= rho_(newest_) *
+      gradient_changes_.col(newest_).squaredNorm();
+
+    // Oldest to newest.
+    index = (index + 1) % Rank();
+    for (size_t ii = 0; ii < num_pairs_; ii++) {
+      const double beta =
+        rho_(index) * gradient_changes_.col(index).dot(direction_);
+      direction_ += (alpha_(index) - beta) * steps_.col(index);
+      index = (index + 1) % Rank();
+    }
+  }
+
+  // Call all callbacks, returning the most severe result.
+  CallbackReturnType LbfgsSolver::Notify(
+    const std::vector<IterationCallback*>& callbacks,
+    size_t iteration, double cost, const VectorXd& parameters) {
+    CallbackReturnType status = CONTINUE;
+    for (size_t ii = 0; ii < callbacks.size(); ii++)
+      status = std::max(status, (*callbacks[ii])(iteration, cost, parameters));
+
+    return status;
+  }
+
+}  //\namespace gp
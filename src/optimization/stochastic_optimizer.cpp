@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the StochasticOptimizer class, which applies SGD (with momentum) or
+// Adam updates to a parameter vector given noisy gradient estimates.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/stochastic_optimizer.hpp>
+
+#include <math.h>
+
+namespace gp {
+
+  StochasticOptimizer::StochasticOptimizer(const StepOptions& options,
+                                           size_t dimension)
+    : options_(options),
+      num_steps_(0),
+      first_moment_(VectorXd::Zero(dimension)),
+      second_moment_(VectorXd::Zero(dimension)) {
+    CHECK_GT(options_.learning_rate, 0.0);
+    CHECK_GE(options_.decay, 0.0);
+    CHECK_GE(options_.momentum, 0.0);
+    CHECK_LT(options_.momentum, 1.0);
+    CHECK_GE(options_.beta1, 0.0);
+    CHECK_LT(options_.beta1, 1.0);
+    CHECK_GE(options_.beta2, 0.0);
+    CHECK_LT(options_.beta2, 1.0);
+  }
+
+  // Take one step from 'x' against the given gradient.
+  void StochasticOptimizer::Step(const Eigen::Ref<const VectorXd>& gradient,
+                                 Eigen::Ref<VectorXd> x) {
+    CHECK_EQ(gradient.size(), x.size());
+    CHECK_EQ(gradient.size(), first_moment_.size());
+
+    const double step_size = LearningRate();
+    num_steps_++;
+
+    if (options_.rule == SGD) {
+      first_moment_ = options_.momentum * first_moment_ + gradient;
+      x -= step_size * first_moment_;
+      return;
+    }
+
+    // Adam, with bias-corrected moment estimates.
+    first_moment_ =
+      options_.beta1 * first_moment_ + (1.0 - options_.beta1) * gradient;
+    second_moment_ = options_.beta2 * second_moment_ +
+      (1.0 - options_.beta2) * gradient.cwiseProduct(gradient);
+
+    const double t = static_cast<double>(num_steps_);
+    const double correction1 = 1.0 - std::pow(options_.beta1, t);
+    const double correction2 = 1.0 - std::pow(options_.beta2, t);
+
+    x.array() -= step_size * (first_moment_.array() / correction1) /
+      ((second_moment_.array() / correction2).sqrt() + options_.epsilon);
+  }
+
+  // Clear moment estimates and the step count.
+  void StochasticOptimizer::Reset() {
+    num_steps_ = 0;
+    first_moment_.setZero();
+    second_moment_.setZero();
+  }
+
+  // Change the dimension, zero-filling new moment estimates.
+  void StochasticOptimizer::Resize(size_t dimension) {
+    const size_t old_dimension = first_moment_.size();
+    first_moment_.conservativeResize(dimension);
+    second_moment_.conservativeResize(dimension);
+
+    if (dimension > old_dimension) {
+      first_moment_.tail(dimension - old_dimension).setZero();
+      second_moment_.tail(dimension - old_dimension).setZero();
+    }
+  }
+
+  // Current learning rate.
+  double StochasticOptimizer::LearningRate() const {
+    return options_.learning_rate /
+      (1.0 + options_.decay * static_cast<double>(num_steps_));
+  }
+
+}  //\namespace gp
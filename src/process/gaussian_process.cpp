@@ -42,27 +42,320 @@
 
 #include <process/gaussian_process.hpp>
 #include <optimization/cost_functors.hpp>
+#include <optimization/lbfgs_solver.hpp>
+#include <optimization/stochastic_optimizer.hpp>
+#include <optimization/trust_region_solver.hpp>
+#include <process/noise_sweep.hpp>
+#include <utils/thread_pool.hpp>
 
+#ifdef GP_USE_CERES
 #include <ceres/ceres.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <math.h>
 #include <random>
+#include <thread>
+#include <type_traits>
 
 namespace gp {
 
+namespace {
+#ifdef GP_USE_CERES
+  // Solver settings shared by all hyperparameter learning modes.
+  void SetSolverOptions(ceres::GradientProblemSolver::Options* options) {
+    options->minimizer_progress_to_stdout = false;
+    options->max_num_iterations = 100;
+    options->max_num_line_search_step_size_iterations = 50;
+    options->max_num_line_search_direction_restarts = 25;
+    options->max_lbfgs_rank = 15;
+    //    options->line_search_type = ceres::ARMIJO;
+    //    options->line_search_direction_type =
+    //      ceres::NONLINEAR_CONJUGATE_GRADIENT;
+  }
+
+  // Ceres takes ownership of the functions it is given, so hand it a thin
+  // wrapper instead.
+  class CeresFunction : public ceres::FirstOrderFunction {
+  public:
+    explicit CeresFunction(const FirstOrderFunction& function)
+      : function_(function) {}
+
+    bool Evaluate(const double* const parameters,
+                  double* cost, double* gradient) const {
+      return function_.Evaluate(parameters, cost, gradient);
+    }
+
+    int NumParameters() const { return function_.NumParameters(); }
+
+  private:
+    const FirstOrderFunction& function_;
+  }; //\class CeresFunction
+
+  // Forwards Ceres iteration callbacks to ours. The solver must be run with
+  // 'update_state_every_iteration' set.
+  class CeresCallback : public ceres::IterationCallback {
+  public:
+    CeresCallback(gp::IterationCallback* callback, const VectorXd& parameters)
+      : callback_(callback),
+        parameters_(parameters) {}
+
+    ceres::CallbackReturnType operator()(
+      const ceres::IterationSummary& summary) {
+      switch ((*callback_)(summary.iteration, summary.cost, parameters_)) {
+      case TERMINATE:
+        return ceres::SOLVER_TERMINATE_SUCCESSFULLY;
+      case ABORT:
+        return ceres::SOLVER_ABORT;
+      default:
+        return ceres::SOLVER_CONTINUE;
+      }
+    }
+
+  private:
+    gp::IterationCallback* const callback_;
+    const VectorXd& parameters_;
+  }; //\class CeresCallback
+#endif
+
+  // Minimize 'function' starting from 'parameters' with the chosen solver,
+  // calling each callback after every iteration. The built-in solver uses
+  // 'lbfgs' as its workspace. Returns whether or not the result is usable.
+  bool Minimize(SolverType solver, const LbfgsOptions& options,
+                size_t max_iterations, double max_seconds,
+                const FirstOrderFunction& function, LbfgsSolver* lbfgs,
+                const std::vector<IterationCallback*>& callbacks,
+                VectorXd& parameters, LbfgsSolver::Summary* summary) {
+    if (solver == BUILTIN_LBFGS) {
+      CHECK_NOTNULL(lbfgs);
+      return lbfgs->Solve(function, options, max_iterations, callbacks,
+                          parameters, summary);
+    }
+
+#ifdef GP_USE_CERES
+    ceres::GradientProblem problem(new CeresFunction(function));
+
+    ceres::GradientProblemSolver::Options solver_options;
+    SetSolverOptions(&solver_options);
+    solver_options.max_num_iterations = static_cast<int>(max_iterations);
+    solver_options.max_lbfgs_rank = static_cast<int>(options.rank);
+    solver_options.max_num_line_search_step_size_iterations =
+      static_cast<int>(options.max_line_search_iterations);
+    solver_options.function_tolerance = options.function_tolerance;
+    solver_options.gradient_tolerance = options.gradient_tolerance;
+    solver_options.update_state_every_iteration = true;
+    if (max_seconds > 0.0)
+      solver_options.max_solver_time_in_seconds = max_seconds;
+
+    std::vector< std::unique_ptr<CeresCallback> > adapters;
+    for (size_t ii = 0; ii < callbacks.size(); ii++) {
+      adapters.emplace_back(new CeresCallback(callbacks[ii], parameters));
+      solver_options.callbacks.push_back(adapters.back().get());
+    }
+
+    ceres::GradientProblemSolver::Summary ceres_summary;
+    ceres::Solve(solver_options, problem, parameters.data(), &ceres_summary);
+
+    summary->usable = ceres_summary.IsSolutionUsable();
+    summary->converged = ceres_summary.termination_type == ceres::CONVERGENCE;
+    summary->num_iterations = ceres_summary.iterations.empty() ?
+      0 : ceres_summary.iterations.back().iteration;
+    summary->num_cost_evaluations = ceres_summary.num_cost_evaluations;
+    summary->num_gradient_evaluations =
+      ceres_summary.num_gradient_evaluations;
+    summary->initial_cost = ceres_summary.initial_cost;
+    summary->final_cost = ceres_summary.final_cost;
+    summary->seconds = ceres_summary.total_time_in_seconds;
+    return summary->usable;
+#else
+    (void)max_seconds;
+    LOG(FATAL) << "Built without Ceres; use BUILTIN_LBFGS.";
+    return false;
+#endif
+  }
+
+  // Tracks the best cost across all starts of a multi-start optimization, and
+  // abandons this start once it is clearly losing.
+  class CancellationCallback : public IterationCallback {
+  public:
+    CancellationCallback(std::atomic<double>* best_cost, double margin,
+                         size_t min_iterations)
+      : best_cost_(best_cost),
+        margin_(margin),
+        min_iterations_(min_iterations) {}
+
+    CallbackReturnType operator()(size_t iteration, double cost,
+                                  const VectorXd& /* parameters */) {
+      double best = best_cost_->load();
+      while (cost < best && !best_cost_->compare_exchange_weak(best, cost)) {}
+
+      if (margin_ > 0.0 && iteration >= min_iterations_ &&
+          cost > best + margin_)
+        return ABORT;
+
+      return CONTINUE;
+    }
+
+  private:
+    std::atomic<double>* const best_cost_;
+    const double margin_;
+    const size_t min_iterations_;
+  }; //\class CancellationCallback
+
+  // Aborts an optimization once the given flag is raised.
+  class AbortCallback : public IterationCallback {
+  public:
+    explicit AbortCallback(const std::atomic<bool>* abort)
+      : abort_(abort) {}
+
+    CallbackReturnType operator()(size_t /* iteration */,
+                                  double /* cost */,
+                                  const VectorXd& /* parameters */) {
+      return abort_->load() ? ABORT : CONTINUE;
+    }
+
+  private:
+    const std::atomic<bool>* const abort_;
+  }; //\class AbortCallback
+
+  // Records the best iterate seen by the solver, and terminates once the
+  // deadline passes (if there is one).
+  class DeadlineCallback : public IterationCallback {
+  public:
+    DeadlineCallback(const VectorXd& parameters,
+                     const std::chrono::steady_clock::time_point& start,
+                     double max_seconds)
+      : best_parameters_(parameters),
+        best_cost_(std::numeric_limits<double>::infinity()),
+        start_(start),
+        max_seconds_(max_seconds),
+        deadline_reached_(false) {}
+
+    CallbackReturnType operator()(size_t /* iteration */, double cost,
+                                  const VectorXd& parameters) {
+      if (cost < best_cost_) {
+        best_cost_ = cost;
+        best_parameters_ = parameters;
+      }
+
+      const double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+      if (max_seconds_ > 0.0 && elapsed >= max_seconds_) {
+        deadline_reached_ = true;
+        return TERMINATE;
+      }
+
+      return CONTINUE;
+    }
+
+    const VectorXd& BestParameters() const { return best_parameters_; }
+    double BestCost() const { return best_cost_; }
+    bool DeadlineReached() const { return deadline_reached_; }
+
+  private:
+    // Best parameters so far.
+    VectorXd best_parameters_;
+    double best_cost_;
+
+    // Deadline.
+    const std::chrono::steady_clock::time_point start_;
+    const double max_seconds_;
+    bool deadline_reached_;
+  }; //\class DeadlineCallback
+
+  // Lower triangle of the training covariance, evaluated from the kernel.
+  // The upper triangle is left at zero, since the Cholesky decomposition
+  // never reads it.
+  class LowerCovarianceFunctor {
+  public:
+    LowerCovarianceFunctor(const Kernel& kernel,
+                           const std::vector<VectorXd>& points, double noise)
+      : kernel_(&kernel),
+        points_(&points),
+        noise_(noise) {}
+
+    double operator()(Eigen::Index row, Eigen::Index col) const {
+      if (col > row)
+        return 0.0;
+
+      const double k = kernel_->Evaluate(points_->at(row), points_->at(col));
+      return (row == col) ? k + noise_ : k;
+    }
+
+  private:
+    const Kernel* kernel_;
+    const std::vector<VectorXd>* points_;
+    double noise_;
+  }; //\class LowerCovarianceFunctor
+
+  // Copy points stored one per column into a new point set, one vector each.
+  PointSet CopyColumnsToPointSet(const Eigen::Ref<const MatrixXd>& columns) {
+    PointSet points(new std::vector<VectorXd>);
+    points->reserve(columns.cols());
+    for (Eigen::Index ii = 0; ii < columns.cols(); ii++)
+      points->emplace_back(columns.col(ii));
+
+    return points;
+  }
+
+  // Whether or not two sets of step options describe the same update rule.
+  bool SameStepOptions(const StepOptions& a, const StepOptions& b) {
+    return a.rule == b.rule && a.learning_rate == b.learning_rate &&
+      a.decay == b.decay && a.momentum == b.momentum &&
+      a.beta1 == b.beta1 && a.beta2 == b.beta2 && a.epsilon == b.epsilon;
+  }
+} //\namespace
+
+  // Online learning state. Steps are taken on a shadow copy of the kernel,
+  // whose parameters are only installed once they drift far enough from the
+  // ones the current factorization was built with.
+  struct GaussianProcess::OnlineLearner {
+    const OnlineOptions options;
+    const Kernel::Ptr kernel;
+    MinibatchLogLikelihood cost;
+    StochasticOptimizer optimizer;
+
+    // Shadow log parameters, and the parameters last seen in the GP's kernel.
+    VectorXd log_params;
+    VectorXd installed_params;
+
+    OnlineLearner(const OnlineOptions& online_options,
+                  const Kernel::Ptr& shadow, const PointSet& points,
+                  const VectorXd* targets, double noise)
+      : options(online_options),
+        kernel(shadow),
+        cost(points, targets, shadow, noise, online_options.num_probes),
+        optimizer(online_options.step, shadow->ImmutableParams().size()),
+        log_params(shadow->ImmutableParams().array().log().matrix()),
+        installed_params(shadow->ImmutableParams()) {}
+  }; //\struct OnlineLearner
+
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
                                    size_t dimension, size_t max_points)
     : kernel_(kernel),
       noise_(noise),
-      dimension_(dimension),
       points_(new std::vector<VectorXd>),
+      dimension_(dimension),
       max_points_(max_points),
-      targets_(max_points),
-      regressed_(max_points),
-      covariance_(max_points, max_points) {
+      compact_(false),
+      stale_factorization_(true),
+      stale_regressed_(true),
+      learned_ready_(false),
+      hyperparams_generation_(0),
+      generation_(0),
+      regressed_generation_(0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_GE(max_points_, 1);
     CHECK_GE(dimension_, 1);
     CHECK_GT(noise_, 0.0);
 
+    // All input dimensions are relevant until pruned.
+    for (size_t ii = 0; ii < dimension_; ii++)
+      relevant_.push_back(ii);
+
     // Random number generator.
     std::random_device rd;
     std::default_random_engine rng(rd());
@@ -70,8 +363,10 @@ namespace gp {
     std::normal_distribution<double> normal(0.0, 0.1);
 
     // Populate 'points_' and 'targets_'.
-    points_->reserve(max_points_);
-    for (size_t ii = 0; ii < max_points / 10 + 1; ii++) {
+    const size_t num_points = max_points_ / 10 + 1;
+    points_->reserve(num_points);
+    Reserve(num_points);
+    for (size_t ii = 0; ii < num_points; ii++) {
       VectorXd x(dimension);
 
       for (size_t jj = 0; jj < dimension_; jj++)
@@ -81,27 +376,24 @@ namespace gp {
       targets_(ii) = normal(rng);
     }
 
-    // Compute covariance matrix.
+    // Compute covariance matrix. Factorization waits for the first query.
     Covariance();
-
-    // Compute Cholesky decomposition of covariance matrix.
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
-
-    // Compute regressed targets.
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
   }
 
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
                                    const PointSet& points, size_t max_points)
     : kernel_(kernel),
       noise_(noise),
-      dimension_(0),
       points_(points),
+      dimension_(0),
       max_points_(max_points),
-      targets_(max_points),
-      regressed_(max_points),
-      covariance_(max_points, max_points) {
+      compact_(false),
+      stale_factorization_(true),
+      stale_regressed_(true),
+      learned_ready_(false),
+      hyperparams_generation_(0),
+      generation_(0),
+      regressed_generation_(0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_NOTNULL(points_.get());
     CHECK_GE(points_->size(), 1);
@@ -112,110 +404,398 @@ namespace gp {
     // Set dimension.
     dimension_ = points_->at(0).size();
 
+    // All input dimensions are relevant until pruned.
+    for (size_t ii = 0; ii < dimension_; ii++)
+      relevant_.push_back(ii);
+
     // Random number generator.
     std::random_device rd;
     std::default_random_engine rng(rd());
     std::normal_distribution<double> normal(0.0, 0.1);
 
     // Populate 'targets_'.
+    Reserve(points_->size());
     for (size_t ii = 0; ii < points_->size(); ii++)
       targets_(ii) = normal(rng);
 
-    // Compute covariance matrix.
+    // Compute covariance matrix. Factorization waits for the first query.
     Covariance();
-
-    // Compute Cholesky decomposition of covariance matrix.
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
-
-    // Compute regressed targets.
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
   }
 
   GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
-                                   const PointSet& points,
-                                   const VectorXd& targets,
+                                   const PointSet& points, VectorXd targets,
                                    size_t max_points)
     : kernel_(kernel),
       noise_(noise),
       points_(points),
+      targets_(std::move(targets)),
+      regressed_(targets_.size()),
       max_points_(max_points),
-      targets_(max_points),
-      regressed_(max_points),
-      covariance_(max_points, max_points) {
+      compact_(false),
+      stale_factorization_(true),
+      stale_regressed_(true),
+      learned_ready_(false),
+      hyperparams_generation_(0),
+      generation_(0),
+      regressed_generation_(0) {
     CHECK_NOTNULL(kernel_.get());
     CHECK_GE(max_points_, 1);
     CHECK_GE(points_->size(), 1);
     CHECK_LE(points_->size(), max_points_);
-    CHECK_EQ(points_->size(), targets.size());
+    CHECK_EQ(points_->size(), targets_.size());
     CHECK_GT(noise_, 0.0);
 
     // Set dimension.
     dimension_ = points_->at(0).size();
 
-    // Set 'targets_'.
-    targets_.head(points_->size()) = targets;
+    // All input dimensions are relevant until pruned.
+    for (size_t ii = 0; ii < dimension_; ii++)
+      relevant_.push_back(ii);
 
-    // Compute covariance matrix.
+    // Compute covariance matrix. Factorization waits for the first query.
     Covariance();
+  }
+
+  GaussianProcess::GaussianProcess(const Kernel::Ptr& kernel, double noise,
+                                   const Eigen::Ref<const MatrixXd>& points,
+                                   const Eigen::Ref<const VectorXd>& targets,
+                                   size_t max_points)
+    : GaussianProcess(kernel, noise, CopyColumnsToPointSet(points),
+                      VectorXd(targets), max_points) {}
+
+  // Stop background learning, if any, before tearing down.
+  GaussianProcess::~GaussianProcess() {
+    CancelLearning();
 
-    // Compute Cholesky decomposition of covariance matrix.
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
+    if (learner_)
+      learner_->thread.join();
 
-    // Compute regressed targets.
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
+    JoinRetiredLearners(true);
   }
 
   // Evaluate mean and variance at a point.
   void GaussianProcess::Evaluate(const VectorXd& x,
                                  double& mean, double& variance) const {
-    // Compute cross covariance.
-    VectorXd cross(points_->size());
+    if (!cache_) {
+      Workspace workspace;
+      Evaluate(x, mean, variance, workspace);
+      return;
+    }
+
+    Regress();
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    PredictionCache::Entry* entry = cache_->Find(x, generation_);
+
+    // Compute cross covariance, unless cached.
+    if (!entry) {
+      VectorXd cross(points_->size());
+      CrossCovariance(x, cross);
+
+      entry = cache_->Insert(x, generation_);
+      entry->cross.swap(cross);
+    }
+
+    // Fill in whatever the cached entry is missing.
+    if (!entry->has_mean || entry->mean_generation != regressed_generation_) {
+      entry->mean = entry->cross.dot(regressed_.head(points_->size()));
+      entry->mean_generation = regressed_generation_;
+      entry->has_mean = true;
+    }
+
+    if (!entry->has_variance) {
+      VectorXd projected;
+      const VectorXd& y = Project(x, projected);
+      entry->variance = kernel_->Evaluate(y, y) -
+        entry->cross.dot(Solve(entry->cross));
+      entry->has_variance = true;
+    }
+
+    mean = entry->mean;
+    variance = entry->variance;
+  }
+
+  // Evaluate with caller-supplied scratch space. The variance only needs the
+  // norm of inv(L) * cross, which is solved in place against the triangular
+  // factor.
+  void GaussianProcess::Evaluate(const VectorXd& x,
+                                 double& mean, double& variance,
+                                 Workspace& workspace) const {
+    Regress();
+
+    const size_t N = points_->size();
+    const VectorXd& y = Project(x, workspace.projected);
+    workspace.cross.resize(N);
+    KernelRow(y, workspace.cross, workspace.scaled);
+
+    mean = workspace.cross.dot(regressed_.head(N));
+
+    if (mixed_) {
+      variance = kernel_->Evaluate(y, y) -
+        workspace.cross.dot(Solve(workspace.cross));
+      return;
+    }
+
+    workspace.solved = workspace.cross;
+    llt_.matrixL().solveInPlace(workspace.solved);
+    variance = kernel_->Evaluate(y, y) - workspace.solved.squaredNorm();
+  }
+
+  // Evaluate the mean of every output, and their shared variance.
+  void GaussianProcess::Evaluate(const VectorXd& x, VectorXd& means,
+                                 double& variance) const {
+    Regress();
+
+    const size_t N = points_->size();
+    VectorXd cross(N);
     CrossCovariance(x, cross);
 
-    // Compute mean and variance.
-    mean = cross.dot(regressed_);
-    variance = 1.0 - cross.dot(llt_.solve(cross));
+    means.resize(NumOutputs());
+    means(0) = cross.dot(regressed_.head(N));
+    if (extra_targets_.cols() > 0) {
+      means.tail(extra_targets_.cols()).noalias() =
+        extra_regressed_.topRows(N).transpose() * cross;
+    }
+
+    VectorXd projected;
+    const VectorXd& y = Project(x, projected);
+    variance = kernel_->Evaluate(y, y) - cross.dot(Solve(cross));
   }
 
   // Evaluate at the ii'th training point.
   void GaussianProcess::EvaluateTrainingPoint(
      size_t ii, double& mean, double& variance) const {
     CHECK_LT(ii, points_->size());
+    Regress();
 
-    // Extract cross covariance (must subtract off added noise).
-    VectorXd cross = covariance_.col(ii);
-    cross(ii) -= noise_;
+    // Extract cross covariance (must subtract off added noise), or regenerate
+    // it if the covariance is not stored.
+    VectorXd cross(points_->size());
+    if (compact_) {
+      for (size_t jj = 0; jj < points_->size(); jj++)
+        cross(jj) = kernel_->Evaluate(points_->at(jj), points_->at(ii));
+    } else {
+      cross = covariance_.Dense().col(ii);
+      cross(ii) -= noise_;
+    }
 
     // Compute mean and variance.
-    mean = cross.dot(regressed_);
-    variance = 1.0 - cross.dot(llt_.solve(cross));
+    mean = cross.dot(regressed_.head(points_->size()));
+    variance = cross(ii) - cross.dot(Solve(cross));
   }
 
+  // Evaluate mean and variance at a batch of points. Points are processed in
+  // chunks, each with one cross covariance and a single solve. Chunks run on
+  // the shared thread pool, as long as each has enough kernel evaluations to
+  // be worth a thread; a lone chunk splits its cross covariance instead.
+  void GaussianProcess::Evaluate(const std::vector<VectorXd>& points,
+                                 VectorXd& means, VectorXd& variances) const {
+    Regress();
+
+    const size_t N = points_->size();
+    const size_t B = points.size();
+    means.resize(B);
+    variances.resize(B);
+
+    const size_t kMaxChunkSize = 1024;
+    const size_t kMinEvaluationsPerChunk = 1 << 15;
+    ThreadPool& pool = ThreadPool::Shared();
+    size_t chunk_size = (B + pool.NumThreads() - 1) / pool.NumThreads();
+    chunk_size = std::min(chunk_size, kMaxChunkSize);
+    chunk_size = std::max(chunk_size,
+                          kMinEvaluationsPerChunk / std::max<size_t>(N, 1));
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    const size_t num_chunks = (B + chunk_size - 1) / chunk_size;
+
+    pool.ParallelFor(num_chunks, [&](size_t chunk) {
+      const size_t first = chunk * chunk_size;
+      const size_t count = std::min(chunk_size, B - first);
+
+      MatrixXd cross;
+      VectorXd projected;
+      CrossCovariance(points, first, count, cross);
+
+      means.segment(first, count).noalias() =
+        cross.transpose() * regressed_.head(N);
+
+      const MatrixXd regressed_cross = Solve(cross);
+      for (size_t ii = 0; ii < count; ii++) {
+        const VectorXd& y = Project(points[first + ii], projected);
+        variances(first + ii) = kernel_->Evaluate(y, y) -
+          cross.col(ii).dot(regressed_cross.col(ii));
+      }
+    });
+  }
+
+  // Bake mean and variance on a regular grid into an interpolation table.
+  GridTable::ConstPtr GaussianProcess::BakeGrid(const VectorXd& lower,
+                                                const VectorXd& upper,
+                                                size_t resolution,
+                                                const GridOptions& options,
+                                                GridSummary* summary) const {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    const size_t D = dimension_;
+    CHECK_LE(D, GridTable::kMaxDimension);
+    CHECK_EQ(lower.size(), D);
+    CHECK_EQ(upper.size(), D);
+    CHECK_GE(resolution, 2);
+
+    // Grid nodes, with the first dimension varying fastest.
+    size_t num_nodes = 1;
+    for (size_t ii = 0; ii < D; ii++)
+      num_nodes *= resolution;
+
+    const VectorXd spacing =
+      (upper - lower) / static_cast<double>(resolution - 1);
+    std::vector<VectorXd> nodes(num_nodes, VectorXd(D));
+    for (size_t ii = 0; ii < num_nodes; ii++) {
+      size_t remainder = ii;
+      for (size_t jj = 0; jj < D; jj++) {
+        nodes[ii](jj) = lower(jj) + spacing(jj) *
+          static_cast<double>(remainder % resolution);
+        remainder /= resolution;
+      }
+    }
+
+    VectorXd means, variances;
+    Evaluate(nodes, means, variances);
+
+    const GridTable::ConstPtr table(new GridTable(
+      lower, upper, resolution, options.interpolation, means, variances));
+
+    if (!summary)
+      return table;
+
+    // Check against the exact GP at random points in the box.
+    summary->num_nodes = num_nodes;
+    summary->max_mean_error = 0.0;
+    summary->rms_mean_error = 0.0;
+    summary->max_variance_error = 0.0;
+    summary->rms_variance_error = 0.0;
+
+    if (options.num_check_points > 0) {
+      std::random_device rd;
+      std::default_random_engine rng(rd());
+      std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+      std::vector<VectorXd> checks(options.num_check_points, VectorXd(D));
+      for (auto& x : checks) {
+        for (size_t jj = 0; jj < D; jj++)
+          x(jj) = lower(jj) + (upper(jj) - lower(jj)) * unif(rng);
+      }
+
+      Evaluate(checks, means, variances);
+
+      for (size_t ii = 0; ii < checks.size(); ii++) {
+        double mean, variance;
+        table->Evaluate(checks[ii], mean, variance);
+
+        const double mean_error = std::abs(mean - means(ii));
+        const double variance_error = std::abs(variance - variances(ii));
+        summary->max_mean_error =
+          std::max(summary->max_mean_error, mean_error);
+        summary->max_variance_error =
+          std::max(summary->max_variance_error, variance_error);
+        summary->rms_mean_error += mean_error * mean_error;
+        summary->rms_variance_error += variance_error * variance_error;
+      }
+
+      const double num_checks = static_cast<double>(checks.size());
+      summary->rms_mean_error = std::sqrt(summary->rms_mean_error / num_checks);
+      summary->rms_variance_error =
+        std::sqrt(summary->rms_variance_error / num_checks);
+    }
+
+    summary->seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    return table;
+  }
+
+  // Copy the model into a read-only process in the given scalar type. With
+  // mixed precision, single precision snapshots take the single precision
+  // factor as is, so only double precision ones need a double precision
+  // factorization.
+  template <typename Scalar>
+  typename ServingProcess<Scalar>::ConstPtr GaussianProcess::Snapshot() const {
+    Regress();
+
+    const size_t N = points_->size();
+    if (mixed_ && std::is_same<Scalar, float>::value &&
+        !mixed_->UsingDouble()) {
+      return typename ServingProcess<Scalar>::ConstPtr(
+        new ServingProcess<Scalar>(
+          kernel_->Clone(), dimension_, relevant_, *points_,
+          regressed_.head(N),
+          mixed_->SingleFactorization().matrixLLT().cast<double>()));
+    }
+
+    return typename ServingProcess<Scalar>::ConstPtr(
+      new ServingProcess<Scalar>(kernel_->Clone(), dimension_, relevant_,
+                                 *points_, regressed_.head(N),
+                                 ImmutableCholesky().matrixLLT()));
+  }
+
+  template ServingProcess<float>::ConstPtr
+  GaussianProcess::Snapshot<float>() const;
+  template ServingProcess<double>::ConstPtr
+  GaussianProcess::Snapshot<double>() const;
+
   // Add new point(s). Returns whether or not points were added (points will
   // only be added until 'max_points' is reached).
   bool GaussianProcess::Add(const VectorXd& x, double target) {
+    CHECK_EQ(NumOutputs(), 1) << "Points need a target for every output.";
+    return AddPoint(x, target);
+  }
+
+  // Add a new point with a target for each output. Targets of the outputs
+  // after the first are stored ahead of the point itself.
+  bool GaussianProcess::Add(const VectorXd& x,
+                            const std::vector<double>& targets) {
+    CHECK_EQ(targets.size(), NumOutputs());
     const size_t N = points_->size();
+    if (N >= max_points_)
+      return false;
 
-    if (N < max_points_) {
-      CHECK_EQ(x.size(), dimension_);
+    Reserve(N + 1);
+    for (size_t ii = 1; ii < targets.size(); ii++)
+      extra_targets_(N, ii - 1) = targets[ii];
 
-      // Add a row/column to the covariance matrix.
-      for (size_t ii = 0; ii < N; ii++) {
-        covariance_(ii, N) = kernel_->Evaluate(x, points_->at(ii));
-        covariance_(N, ii) = covariance_(ii, N);
-      }
+    return AddPoint(x, targets[0]);
+  }
+
+  // Add a point, and a target for the first output.
+  bool GaussianProcess::AddPoint(const VectorXd& x, double target) {
+    InstallHyperparams();
+    const size_t N = points_->size();
 
-      covariance_(N, N) = 1.0 + noise_;
+    if (N < max_points_) {
+      VectorXd projected;
+      const VectorXd& y = Project(x, projected);
+
+      // Add a row to the covariance matrix.
+      Reserve(N + 1);
+      if (!compact_) {
+        covariance_.Resize(N + 1);
+        Eigen::Map<VectorXd> row = covariance_.Row(N);
+        VectorXd scaled;
+        KernelRow(y, row.head(N), scaled);
+        row(N) = kernel_->Evaluate(y, y) + noise_;
+      }
 
       // Add the new point/target.
       targets_(N) = target;
-      points_->push_back(x);
+      {
+        std::lock_guard<std::mutex> lock(learner_mutex_);
+        points_->push_back(y);
+      }
+
+      ModelChanged();
 
-      // Recompute Cholesky decomposition and regressed targets.
-      llt_.compute(covariance_.topLeftCorner(N + 1, N + 1));
-      regressed_.head(N + 1) = llt_.solve(targets_.head(N + 1));
+      // Adapt hyperparameters, recomputing the covariance if they changed.
+      if (online_ && AdaptHyperparams())
+        Refactorize();
 
       return true;
     }
@@ -228,142 +808,1141 @@ namespace gp {
   bool GaussianProcess::Add(const std::vector<VectorXd>& points,
                             const VectorXd& targets) {
     CHECK_EQ(points.size(), targets.size());
-    const bool has_room = points_->size() + points.size() <= max_points_;
+    const auto point = [&points](size_t ii) -> const VectorXd& {
+      return points[ii];
+    };
+    return AddBatch(points.size(), point, targets);
+  }
 
-    // Add points one at a time.
-    for (size_t ii = 0; ii < points.size(); ii++) {
-      CHECK_EQ(points[ii].size(), dimension_);
-      const size_t N = points_->size();
+  bool GaussianProcess::Add(const Eigen::Ref<const MatrixXd>& points,
+                            const Eigen::Ref<const VectorXd>& targets) {
+    CHECK_EQ(points.cols(), targets.size());
+    const auto point = [&points](size_t ii) { return points.col(ii); };
+    return AddBatch(points.cols(), point, targets);
+  }
 
+  // Add a batch of points, one at a time.
+  template <typename PointAccessor>
+  bool GaussianProcess::AddBatch(size_t count, const PointAccessor& point,
+                                 const Eigen::Ref<const VectorXd>& targets) {
+    CHECK_EQ(NumOutputs(), 1) << "Points need a target for every output.";
+    InstallHyperparams();
+    const size_t initial_size = points_->size();
+    const bool has_room = initial_size + count <= max_points_;
+
+    // Add points one at a time. Each is copied straight from the caller into
+    // the point set (only its relevant dimensions, if any were pruned).
+    Reserve(std::min(max_points_, initial_size + count));
+    const bool pruned = relevant_.size() < dimension_;
+    VectorXd projected, scaled;
+    for (size_t ii = 0; ii < count; ii++) {
+      const size_t N = points_->size();
       if (N >= max_points_)
         break;
 
-      // Add a row/column to the covariance matrix.
-      for (size_t jj = 0; jj < N; jj++) {
-        covariance_(jj, N) = kernel_->Evaluate(points[ii], points_->at(jj));
-        covariance_(N, jj) = covariance_(jj, N);
+      CHECK_EQ(point(ii).size(), dimension_);
+      if (pruned) {
+        projected.resize(relevant_.size());
+        for (size_t jj = 0; jj < relevant_.size(); jj++)
+          projected(jj) = point(ii)(relevant_[jj]);
       }
 
-      covariance_(N, N) = 1.0 + noise_;
-
       // Add the new point/target.
+      {
+        std::lock_guard<std::mutex> lock(learner_mutex_);
+        if (pruned)
+          points_->push_back(std::move(projected));
+        else
+          points_->emplace_back(point(ii));
+      }
       targets_(N) = targets(ii);
-      points_->push_back(points[ii]);
+      const VectorXd& x = points_->back();
+
+      // Add a row to the covariance matrix, against the points before it.
+      if (!compact_) {
+        covariance_.Resize(N + 1);
+        Eigen::Map<VectorXd> row = covariance_.Row(N);
+        KernelRow(x, row.head(N), scaled);
+        row(N) = kernel_->Evaluate(x, x) + noise_;
+      }
+
+      // Scale the point for the rest of the batch.
+      scaled_points_.Update(*kernel_, *points_);
     }
 
-    // Recompute Cholesky decomposition and regressed targets.
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
+    ModelChanged();
 
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
+    // Adapt hyperparameters once for the whole batch, recomputing the
+    // covariance if they changed.
+    if (online_ && points_->size() > initial_size && AdaptHyperparams())
+      Refactorize();
 
     return has_room;
   }
 
   // Update the training targets in the direction of the gradient of the
   // mean squared error at the given points. Returns the mean squared error.
-  // If 'finalize' is set, computes regressed targets - only set to false if
-  // you are doing repeated updates, and be sure to set true on final update.
   double GaussianProcess::UpdateTargets(const std::vector<VectorXd>& points,
                                         const std::vector<double>& targets,
-                                        double step_size, bool finalize) {
+                                        double step_size) {
     CHECK_EQ(points.size(), targets.size());
+    InstallHyperparams();
 
-    // Initialize 'mse' and 'grad' to zero.
-    double mse = 0.0;
-    VectorXd grad(VectorXd::Zero(targets_.size()));
+    VectorXd grad;
+    const double mse = TargetGradient(points, targets, grad);
 
-    // Accumulate across all points/targets.
-    VectorXd cross(points_->size());
-    VectorXd regressed_cross(points_->size());
-    for (size_t ii = 0; ii < points.size(); ii++) {
-      // Get the cross covariance against the training points.
-      CrossCovariance(points[ii], cross);
+    // Gradient update.
+    targets_.head(points_->size()) -= step_size * grad;
+    RegressedTargetsChanged();
 
-      // Compute regressed cross covariance.
-      regressed_cross = llt_.solve(cross);
+    return mse;
+  }
 
-      // Compute error and accumulate MSE and gradient.
-      const double error =
-        regressed_cross.dot(targets_.head(points_->size())) - targets[ii];
 
-      mse += error * error;
-      grad += error * regressed_cross;
-    }
+  // Same, but steps the targets with SGD (with momentum) or Adam.
+  double GaussianProcess::UpdateTargets(const std::vector<VectorXd>& points,
+                                        const std::vector<double>& targets,
+                                        const StepOptions& options) {
+    CHECK_EQ(points.size(), targets.size());
+    InstallHyperparams();
 
-    // Tack on constants.
-    mse /= static_cast<double>(points.size());
-    grad *= 2.0 / static_cast<double>(points.size());
+    if (!target_optimizer_ ||
+        !SameStepOptions(target_optimizer_->Options(), options))
+      target_optimizer_.reset(new StochasticOptimizer(options, 0));
 
-    // Gradient update.
-    targets_.head(points_->size()) -= step_size * grad;
+    VectorXd grad;
+    const double mse = TargetGradient(points, targets, grad);
 
-    // Maybe update regressed targets.
-    if (finalize)
-      regressed_.head(points_->size()) =
-        llt_.solve(targets_.head(points_->size()));
+    // Points added since the last step start with zero moment estimates.
+    const size_t N = points_->size();
+    target_optimizer_->Resize(N);
+    target_optimizer_->Step(grad, targets_.head(N));
+    RegressedTargetsChanged();
 
     return mse;
   }
 
+  // Mean squared error of the mean at the given points, and its gradient
+  // against the training targets. With R = inv(K) * cross, the errors are
+  // R^T * targets - batch targets, and the gradient is 2 / B * R * errors.
+  double GaussianProcess::TargetGradient(const std::vector<VectorXd>& points,
+                                         const std::vector<double>& targets,
+                                         VectorXd& gradient) const {
+    const size_t N = points_->size();
+    const size_t B = points.size();
+    CHECK_GE(B, 1);
+    Factorize();
+
+    // Solve for the whole batch at once.
+    MatrixXd cross;
+    if (cache_) {
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      cross.resize(N, B);
+      for (size_t ii = 0; ii < B; ii++) {
+        PredictionCache::Entry* entry = cache_->Find(points[ii], generation_);
+        if (!entry) {
+          entry = cache_->Insert(points[ii], generation_);
+          entry->cross.resize(N);
+          CrossCovariance(points[ii], entry->cross);
+        }
+
+        cross.col(ii) = entry->cross;
+      }
+    } else {
+      CrossCovariance(points, 0, B, cross);
+    }
+
+    const MatrixXd regressed_cross = Solve(cross);
+
+    VectorXd errors = regressed_cross.transpose() * targets_.head(N);
+    for (size_t ii = 0; ii < B; ii++)
+      errors(ii) -= targets[ii];
+
+    gradient.noalias() =
+      (2.0 / static_cast<double>(B)) * regressed_cross * errors;
+    return errors.squaredNorm() / static_cast<double>(B);
+  }
 
   // Learn kernel hyperparameters by maximizing the log-likelihood of the
   // training data.
   bool GaussianProcess::LearnHyperparams() {
-    // Create a Ceres problem.
-    TrainingLogLikelihood* cost =
-      new TrainingLogLikelihood(points_, &targets_, kernel_, noise_);
-    ceres::GradientProblem problem(cost);
-
-    // Create a parameter vector.
-    VectorXd& kernel_params = kernel_->Params();
-    double parameters[kernel_params.size()];
-    for (size_t ii = 0; ii < kernel_params.size(); ii++)
-      parameters[ii] = kernel_params(ii);
-
-    // Set solver parameters.
-    ceres::GradientProblemSolver::Summary summary;
-    ceres::GradientProblemSolver::Options options;
-    options.minimizer_progress_to_stdout = false;
-    options.max_num_iterations = 100;
-    options.max_num_line_search_step_size_iterations = 50;
-    options.max_num_line_search_direction_restarts = 25;
-    options.max_lbfgs_rank = 15;
-    //    options.line_search_type = ceres::ARMIJO;
-    //    options.line_search_direction_type = ceres::NONLINEAR_CONJUGATE_GRADIENT;
-
-    ceres::Solve(options, problem, parameters, &summary);
-
-    // Store the parameters back in the kernel.
-    for (size_t ii = 0; ii < kernel_params.size(); ii++)
-      kernel_params(ii) = parameters[ii];
-
-    // Recompute covariance, cholesky, and regressed targets.
+    return LearnHyperparams(LearningOptions());
+  }
+
+  // Same, but within an iteration and wall-clock budget. When the budget
+  // runs out, installs the best hyperparameters found so far. The GP is left
+  // untouched unless learning succeeds. Optionally reports a summary.
+  bool GaussianProcess::LearnHyperparams(const LearningOptions& options,
+                                         LearningSummary* summary) {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    CancelLearning();
+
+    // Optimize over a clone of the kernel, so that the GP's own kernel is only
+    // touched once learning is done.
+    const Kernel::Ptr kernel = kernel_->Clone();
+    CHECK(!options.learn_noise || NumOutputs() == 1)
+      << "Noise learning only supports a single output.";
+    const MatrixXd targets = OutputTargets();
+    VectorXd parameters = kernel->ImmutableParams();
+
+    // The built-in solver's workspace (and curvature pairs, for warm starts)
+    // persists across calls.
+    if (options.solver == BUILTIN_LBFGS &&
+        (!lbfgs_ ||
+         lbfgs_->NumParameters() != static_cast<size_t>(parameters.size()) ||
+         lbfgs_->Rank() != options.lbfgs.rank))
+      lbfgs_.reset(new LbfgsSolver(parameters.size(), options.lbfgs.rank));
+
+    // Optimize the kernel parameters at a fixed noise variance. If learning
+    // the noise variance too, first sweep it at the initial kernel parameters
+    // (a poor starting noise variance can send the kernel to a degenerate
+    // optimum, e.g. a vanishing length scale), then sweep it again at the
+    // learned kernel parameters and optimize the kernel at the chosen noise
+    // variance, until the noise variance settles. The cost functor has the noise variance baked in, so
+    // each round gets its own; the one from the last round that succeeded is
+    // kept for its factorization.
+    const size_t N = points_->size();
+    double noise = noise_;
+    if (options.learn_noise)
+      noise = NoiseSweep(kernel, points_, targets_.head(N))
+        .BestNoise(options.noise);
+
+    double cost_noise = noise;
+    double best_cost = std::numeric_limits<double>::infinity();
+    std::unique_ptr<TrainingLogLikelihood> cost;
+    LbfgsSolver::Summary totals;
+    bool deadline_reached = false;
+    for (size_t round = 0; ; round++) {
+      // Later rounds only get what is left of the budget.
+      double max_seconds = options.max_seconds;
+      if (options.max_seconds > 0.0) {
+        max_seconds -= std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+        if (round > 0 && max_seconds <= 0.0) {
+          deadline_reached = true;
+          break;
+        }
+      }
+
+      std::unique_ptr<TrainingLogLikelihood> round_cost(
+        new TrainingLogLikelihood(points_, targets, kernel, noise,
+                                  Refinement()));
+      VectorXd round_parameters = parameters;
+
+      // Track the best iterate against the deadline.
+      DeadlineCallback callback(round_parameters, start, options.max_seconds);
+      const std::vector<IterationCallback*> callbacks(1, &callback);
+
+      LbfgsSolver::Summary solver_summary;
+      Minimize(options.solver, options.lbfgs, options.max_iterations,
+               max_seconds, *round_cost, lbfgs_.get(), callbacks,
+               round_parameters, &solver_summary);
+
+      if (round == 0)
+        totals.initial_cost = solver_summary.initial_cost;
+      totals.num_iterations += solver_summary.num_iterations;
+      totals.num_cost_evaluations += solver_summary.num_cost_evaluations;
+      totals.num_gradient_evaluations +=
+        solver_summary.num_gradient_evaluations;
+      deadline_reached = deadline_reached || callback.DeadlineReached() ||
+        (max_seconds > 0.0 && solver_summary.seconds >= max_seconds);
+
+      // Keep whichever is better: the solver's answer or the best iterate.
+      double round_best = callback.BestCost();
+      if (solver_summary.usable && solver_summary.final_cost <= round_best) {
+        round_best = solver_summary.final_cost;
+      } else {
+        round_parameters = callback.BestParameters();
+      }
+
+      // If a later round fails, keep the previous one.
+      if (round_best == std::numeric_limits<double>::infinity())
+        break;
+
+      parameters = round_parameters;
+      best_cost = round_best;
+      cost.swap(round_cost);
+      cost_noise = noise;
+
+      if (!options.learn_noise)
+        break;
+
+      kernel->Reset(parameters);
+      const double swept = NoiseSweep(kernel, points_, targets_.head(N))
+        .BestNoise(options.noise);
+      const bool settled = std::abs(std::log(swept / noise)) <=
+        std::log1p(options.noise_tolerance);
+
+      noise = swept;
+      if (settled || deadline_reached || round + 1 >= options.max_noise_rounds)
+        break;
+    }
+
+    bool success = best_cost < std::numeric_limits<double>::infinity();
+
+    // Factorize at the chosen parameters before touching the GP, reusing the
+    // cost functor's factorization when it was built at the chosen noise
+    // variance.
+    std::unique_ptr<GaussianProcess> factorized;
+    const GaussianProcess* cached = NULL;
+    if (success) {
+      kernel->Reset(parameters);
+      if (noise == cost_noise)
+        cached = cost->CachedProcess(parameters.data());
+
+      if (!cached) {
+        factorized.reset(new GaussianProcess(
+          kernel, noise, points_, targets_.head(N), N));
+        cached = factorized.get();
+      }
+
+      success = cached->Factorized();
+    }
+
+    // Install.
+    if (success) {
+      kernel_->Reset(parameters);
+      SetNoiseWithoutRefactorizing(noise);
+      Refactorize(cached);
+    }
+
+    if (summary) {
+      summary->success = success;
+      summary->deadline_reached = deadline_reached;
+      summary->num_iterations = totals.num_iterations;
+      summary->num_cost_evaluations = totals.num_cost_evaluations;
+      summary->num_gradient_evaluations = totals.num_gradient_evaluations;
+      summary->initial_cost = totals.initial_cost;
+      summary->final_cost = success ? best_cost : totals.initial_cost;
+      summary->seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+
+    return success;
+  }
+
+
+  // Learn kernel hyperparameters with a trust region Newton method.
+  bool GaussianProcess::LearnHyperparams(const NewtonOptions& options,
+                                         LearningSummary* summary) {
+    CancelLearning();
+
+    // Optimize over a clone of the kernel, so that the GP's own kernel is
+    // only touched once learning is done.
+    const Kernel::Ptr kernel = kernel_->Clone();
+    const TrainingLogLikelihood cost(points_, OutputTargets(), kernel, noise_,
+                                     Refinement());
+    VectorXd parameters = kernel->ImmutableParams();
+
+    const TrustRegionSolver solver(options);
+    if (!solver.Solve(cost, parameters, summary))
+      return false;
+
+    // Install, reusing the cost functor's factorization when possible. The
+    // solver only ever accepts parameters at which the cost is finite, so the
+    // factorization succeeded there.
+    kernel_->Reset(parameters);
+    Refactorize(cost.CachedProcess(parameters.data()));
+
+    return Factorized();
+  }
+
+  // Learn kernel hyperparameters from several starting points in parallel,
+  // keeping the result with the highest log-likelihood.
+  bool GaussianProcess::LearnHyperparams(const MultiStartOptions& options) {
+    CancelLearning();
+
+    CHECK_GE(options.num_starts, 1);
+    CHECK_GT(options.min_param, 0.0);
+    CHECK_GT(options.max_param, options.min_param);
+
+    const size_t num_starts = options.num_starts;
+    const size_t num_params = kernel_->ImmutableParams().size();
+
+    // Random number generator.
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    // Draw starting parameters in log space. For Latin hypercube sampling,
+    // each start falls in a different stratum along every parameter.
+    const double log_min = std::log(options.min_param);
+    const double log_range = std::log(options.max_param) - log_min;
+
+    std::vector<VectorXd> starts(num_starts, VectorXd(num_params));
+    std::vector<size_t> strata(num_starts);
+    for (size_t ii = 0; ii < num_params; ii++) {
+      for (size_t jj = 0; jj < num_starts; jj++)
+        strata[jj] = jj;
+
+      if (options.sampling == LATIN_HYPERCUBE)
+        std::shuffle(strata.begin(), strata.end(), rng);
+
+      for (size_t jj = 0; jj < num_starts; jj++) {
+        const double u = (options.sampling == LATIN_HYPERCUBE) ?
+          (static_cast<double>(strata[jj]) + unif(rng)) /
+          static_cast<double>(num_starts) : unif(rng);
+
+        starts[jj](ii) = std::exp(log_min + log_range * u);
+      }
+    }
+
+    if (options.include_current)
+      starts[0] = kernel_->ImmutableParams();
+
+    // Each start gets its own kernel clone and cost functor, which holds its
+    // own factorization. Functors are kept alive so that the winning
+    // factorization can be reused.
+    std::vector< std::unique_ptr<TrainingLogLikelihood> > costs(num_starts);
+    std::vector<LbfgsSolver::Summary> summaries(num_starts);
+    const MatrixXd targets = OutputTargets();
+    for (size_t ii = 0; ii < num_starts; ii++) {
+      costs[ii].reset(new TrainingLogLikelihood(
+        points_, targets, kernel_->Clone(), noise_, Refinement()));
+    }
+
+    // Run starts on a pool of threads, each with its own solver workspace.
+    std::atomic<double> best_cost(std::numeric_limits<double>::infinity());
+    std::atomic<size_t> next_start(0);
+
+    LbfgsOptions lbfgs_options = options.lbfgs;
+    lbfgs_options.warm_start = false;
+
+    auto worker = [&]() {
+      CancellationCallback callback(
+        &best_cost, options.cancel_margin, options.min_iterations);
+      const std::vector<IterationCallback*> callbacks(1, &callback);
+      LbfgsSolver lbfgs(num_params, lbfgs_options.rank);
+
+      for (size_t ii = next_start++; ii < num_starts; ii = next_start++)
+        Minimize(options.solver, lbfgs_options, options.max_iterations, 0.0,
+                 *costs[ii], &lbfgs, callbacks, starts[ii], &summaries[ii]);
+    };
+
+    const size_t num_threads = (options.num_threads == 0) ?
+      num_starts : std::min(options.num_threads, num_starts);
+
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < num_threads; ii++)
+      threads.push_back(std::thread(worker));
+
+    for (size_t ii = 0; ii < num_threads; ii++)
+      threads[ii].join();
+
+    // Pick the usable start with the lowest cost.
+    size_t best = num_starts;
+    for (size_t ii = 0; ii < num_starts; ii++) {
+      if (summaries[ii].usable &&
+          (best == num_starts ||
+           summaries[ii].final_cost < summaries[best].final_cost))
+        best = ii;
+    }
+
+    if (best == num_starts)
+      return false;
+
+    // Store the winning parameters in the kernel and reuse its factorization
+    // when possible.
+    kernel_->Reset(starts[best]);
+    Refactorize(costs[best]->CachedProcess(starts[best].data()));
+
+    return Factorized();
+  }
+
+  // Learn kernel hyperparameters with stochastic gradient steps on the
+  // log-likelihood of random minibatches of the training data.
+  bool GaussianProcess::LearnHyperparams(const StochasticOptions& options) {
+    CHECK_EQ(NumOutputs(), 1)
+      << "Stochastic learning only supports a single output.";
+    CancelLearning();
+
+    const size_t N = points_->size();
+    const size_t B = std::min(options.batch_size, N);
+    CHECK_GE(B, 1);
+
+    // Optimize over a clone of the kernel, so that the GP's own kernel is only
+    // touched once learning is done.
+    const Kernel::Ptr kernel = kernel_->Clone();
+    MinibatchLogLikelihood cost(
+      points_, &targets_, kernel, noise_, options.num_probes);
+
+    // Optimize over log parameters, which keeps them positive.
+    VectorXd log_params = kernel->ImmutableParams().array().log().matrix();
+    StochasticOptimizer optimizer(options.step, log_params.size());
+
+    // Random number generator.
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+
+    std::vector<size_t> indices(N);
+    for (size_t ii = 0; ii < N; ii++)
+      indices[ii] = ii;
+
+    std::vector<size_t> batch(B);
+    double batch_cost;
+    VectorXd gradient;
+    for (size_t ii = 0; ii < options.num_iterations; ii++) {
+      // Draw a minibatch without replacement (partial Fisher-Yates shuffle).
+      for (size_t jj = 0; jj < B; jj++) {
+        std::uniform_int_distribution<size_t> pick(jj, N - 1);
+        std::swap(indices[jj], indices[pick(rng)]);
+        batch[jj] = indices[jj];
+      }
+
+      if (!cost.Evaluate(batch, &batch_cost, gradient))
+        return false;
+
+      // Chain rule to log parameters, then step.
+      optimizer.Step(gradient.cwiseProduct(kernel->ImmutableParams()),
+                     log_params);
+      kernel->Reset(log_params.array().exp().matrix());
+    }
+
+    // Install, and recompute covariance, cholesky, and regressed targets.
+    kernel_->Reset(kernel->ImmutableParams());
+    Refactorize();
+
+    return Factorized();
+  }
+
+  // Set the noise variance, and refactorize.
+  bool GaussianProcess::SetNoise(double noise) {
+    CancelLearning();
+    SetNoiseWithoutRefactorizing(noise);
+    Refactorize();
+
+    return Factorized();
+  }
+
+  // Choose the noise variance with a sweep over a cached eigendecomposition
+  // of the noise-free covariance, then refactorize once.
+  bool GaussianProcess::LearnNoise(const NoiseOptions& options) {
+    CHECK_EQ(NumOutputs(), 1) << "Noise learning only supports a single output.";
+    CancelLearning();
+
+    const size_t N = points_->size();
+    const NoiseSweep sweep(kernel_, points_, targets_.head(N));
+    return SetNoise(sweep.BestNoise(options));
+  }
+
+  // Drop input dimensions along which the kernel is nearly constant over the
+  // training points.
+  size_t GaussianProcess::PruneDimensions(const PruningOptions& options) {
+    CHECK_GE(options.tolerance, 0.0);
+
+    // The number of kernel parameters is about to change, and the training
+    // points are compacted in place, so let background learning finish and
+    // install its result first.
+    if (learner_) {
+      learner_->thread.join();
+      learner_.reset();
+    }
+
+    JoinRetiredLearners(true);
+    InstallHyperparams();
+
+    VectorXd inverse_lengths;
+    if (!kernel_->InverseLengthScales(inverse_lengths))
+      return 0;
+
+    const size_t D = relevant_.size();
+    CHECK_EQ(inverse_lengths.size(), D);
+
+    // Spread of the training points along each remaining dimension.
+    VectorXd lower = points_->at(0);
+    VectorXd upper = points_->at(0);
+    for (size_t ii = 1; ii < points_->size(); ii++) {
+      lower = lower.cwiseMin(points_->at(ii));
+      upper = upper.cwiseMax(points_->at(ii));
+    }
+
+    const VectorXd relevance =
+      (upper - lower).cwiseProduct(inverse_lengths.cwiseAbs());
+
+    // Keep dimensions above tolerance, and always at least the most relevant.
+    std::vector<size_t> kept;
+    for (size_t ii = 0; ii < D; ii++) {
+      if (relevance(ii) > options.tolerance)
+        kept.push_back(ii);
+    }
+
+    if (kept.empty()) {
+      VectorXd::Index most_relevant;
+      relevance.maxCoeff(&most_relevant);
+      kept.push_back(static_cast<size_t>(most_relevant));
+    }
+
+    if (kept.size() == D || !kernel_->Restrict(kept))
+      return 0;
+
+    // Compact the training points in place.
+    VectorXd compacted(kept.size());
+    for (size_t ii = 0; ii < points_->size(); ii++) {
+      VectorXd& x = points_->at(ii);
+      for (size_t jj = 0; jj < kept.size(); jj++)
+        compacted(jj) = x(kept[jj]);
+
+      x = compacted;
+    }
+
+    // Map kept dimensions back to input dimensions.
+    std::vector<size_t> relevant(kept.size());
+    for (size_t ii = 0; ii < kept.size(); ii++)
+      relevant[ii] = relevant_[kept[ii]];
+
+    relevant_.swap(relevant);
+
+    // The online learner's shadow kernel still has the old dimension.
+    if (online_) {
+      const OnlineOptions online_options = online_->options;
+      online_.reset(new OnlineLearner(
+        online_options, kernel_->Clone(), points_, &targets_, noise_));
+    }
+
+    Refactorize();
+    return D - kept.size();
+  }
+
+  // Turn the prediction cache on/off, and report how well it is doing.
+  void GaussianProcess::EnablePredictionCache(size_t capacity) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.reset(new PredictionCache(capacity));
+  }
+
+  void GaussianProcess::DisablePredictionCache() {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.reset();
+  }
+
+  PredictionCache::Statistics GaussianProcess::PredictionCacheStatistics() const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return cache_ ? cache_->ImmutableStatistics() : PredictionCache::Statistics();
+  }
+
+  // Turn compact storage on/off. The covariance is unchanged either way, so
+  // the factorization stays valid.
+  void GaussianProcess::EnableCompactStorage() {
+    CHECK(!mixed_) << "Compact storage is not available with mixed precision.";
+    compact_ = true;
+    covariance_ = PackedSymmetricMatrix();
+  }
+
+  void GaussianProcess::DisableCompactStorage() {
+    compact_ = false;
     Covariance();
+  }
+
+  // Turn mixed precision factorization on/off. Either way the factorization
+  // must be recomputed.
+  void GaussianProcess::EnableMixedPrecision(const RefinementOptions& options) {
+    CHECK(!compact_) << "Mixed precision is not available with compact storage.";
+    mixed_.reset(new MixedPrecisionCholesky(options));
+    refinement_ = RefinementSummary();
+    ModelChanged();
+  }
+
+  void GaussianProcess::DisableMixedPrecision() {
+    mixed_.reset();
+    refinement_ = RefinementSummary();
+    ModelChanged();
+  }
+
+  // Turn online hyperparameter learning on/off.
+  void GaussianProcess::EnableOnlineLearning(const OnlineOptions& options) {
+    CHECK_GE(options.window_size, 1);
+    CHECK_GT(options.max_drift, 0.0);
+    CHECK_EQ(NumOutputs(), 1) << "Online learning only supports a single output.";
+
+    InstallHyperparams();
+    online_.reset(new OnlineLearner(
+      options, kernel_->Clone(), points_, &targets_, noise_));
+  }
 
-    llt_.compute(covariance_.topLeftCorner(points_->size(), points_->size()));
+  void GaussianProcess::DisableOnlineLearning() { online_.reset(); }
 
-    regressed_.head(points_->size()) =
-      llt_.solve(targets_.head(points_->size()));
+  // Change the noise variance without touching the factorization. The online
+  // learner's cost functor has the noise baked in, so rebuild it.
+  void GaussianProcess::SetNoiseWithoutRefactorizing(double noise) {
+    CHECK_GT(noise, 0.0);
+    if (noise == noise_)
+      return;
 
-    return summary.IsSolutionUsable();
+    noise_ = noise;
+    if (online_) {
+      const OnlineOptions options = online_->options;
+      online_.reset(new OnlineLearner(
+        options, kernel_->Clone(), points_, &targets_, noise_));
+    }
+  }
+
+  // Take online learning steps on the most recent points.
+  bool GaussianProcess::AdaptHyperparams() {
+    OnlineLearner& online = *online_;
+
+    // Start over from the GP's kernel if it was changed elsewhere, e.g. by
+    // LearnHyperparams.
+    if (kernel_->ImmutableParams() != online.installed_params) {
+      online.installed_params = kernel_->ImmutableParams();
+      online.log_params = online.installed_params.array().log().matrix();
+      online.kernel->Reset(online.installed_params);
+      online.optimizer.Reset();
+    }
+
+    // Window of most recent points.
+    const size_t N = points_->size();
+    const size_t W = std::min(online.options.window_size, N);
+
+    std::vector<size_t> window(W);
+    for (size_t ii = 0; ii < W; ii++)
+      window[ii] = N - W + ii;
+
+    double cost;
+    VectorXd gradient;
+    for (size_t ii = 0; ii < online.options.steps_per_add; ii++) {
+      if (!online.cost.Evaluate(window, &cost, gradient))
+        break;
+
+      // Chain rule to log parameters, then step.
+      online.optimizer.Step(
+        gradient.cwiseProduct(online.kernel->ImmutableParams()),
+        online.log_params);
+      online.kernel->Reset(online.log_params.array().exp().matrix());
+    }
+
+    // Install the shadow parameters only once they have drifted far enough.
+    const double drift = (online.log_params.array() -
+                          online.installed_params.array().log()).abs().maxCoeff();
+    if (drift <= online.options.max_drift)
+      return false;
+
+    CancelLearning();
+    online.installed_params = online.kernel->ImmutableParams();
+    kernel_->Reset(online.installed_params);
+    return true;
+  }
+
+  // Learn kernel hyperparameters in a background thread, on a snapshot of
+  // the training points and targets.
+  std::future<bool> GaussianProcess::LearnHyperparamsAsync() {
+    InstallHyperparams();
+
+    // Only one background optimization at a time. Cancel the previous one
+    // rather than waiting for it, and join it once it has wound down.
+    CancelLearning();
+    if (learner_)
+      retired_learners_.push_back(std::move(learner_));
+
+    JoinRetiredLearners(false);
+
+    // Snapshot the training data and clone the kernel.
+    const PointSet points(new std::vector<VectorXd>(*points_));
+    const MatrixXd targets = OutputTargets();
+
+    std::promise<bool> promise;
+    std::future<bool> future = promise.get_future();
+
+    learner_.reset(new BackgroundLearner);
+    learner_->thread = std::thread(&GaussianProcess::LearnInBackground, this,
+                                   learner_.get(), points, targets,
+                                   kernel_->Clone(), noise_,
+                                   hyperparams_generation_, std::move(promise));
+    return future;
+  }
+
+  // Install hyperparameters learned in the background, if they are ready.
+  // Returns whether or not anything was installed.
+  bool GaussianProcess::InstallHyperparams() {
+    if (!learned_ready_)
+      return false;
+
+    std::unique_ptr<LearnedHyperparams> learned;
+    {
+      std::lock_guard<std::mutex> lock(learner_mutex_);
+      learned.swap(learned_);
+      learned_ready_ = false;
+    }
+
+    // Drop results learned from a snapshot whose hyperparameters or noise
+    // variance have been changed since.
+    if (!learned || learned->generation != hyperparams_generation_)
+      return false;
+
+    // Swap in the new kernel parameters and factorization.
+    kernel_->Reset(learned->params);
+    ModelChanged();
+
+    const size_t N = points_->size();
+    const size_t M = learned->covariance.Size();
+    CHECK_LE(M, N);
+
+    if (M == N && !mixed_) {
+      llt_ = learned->llt;
+      stale_factorization_ = false;
+    }
+
+    // Without a stored covariance, points added in the meantime are picked
+    // up by the next factorization.
+    if (compact_)
+      return true;
+
+    // Replay points added after the background thread last caught up.
+    covariance_.SetLeadingBlock(learned->covariance);
+    VectorXd scaled;
+    for (size_t ii = M; ii < N; ii++) {
+      Eigen::Map<VectorXd> row = covariance_.Row(ii);
+      row(ii) = kernel_->Evaluate(points_->at(ii), points_->at(ii)) + noise_;
+      KernelRow(points_->at(ii), row.head(ii), scaled);
+    }
+
+    return true;
+  }
+
+  // Cancel background learning, and make sure that nothing it has learned,
+  // or will learn, gets installed.
+  void GaussianProcess::CancelLearning() {
+    if (learner_)
+      learner_->cancel = true;
+
+    std::lock_guard<std::mutex> lock(learner_mutex_);
+    hyperparams_generation_++;
+    learned_.reset();
+    learned_ready_ = false;
+  }
+
+  // Join cancelled background learners, waiting for them if asked to.
+  void GaussianProcess::JoinRetiredLearners(bool wait) {
+    for (size_t ii = 0; ii < retired_learners_.size(); ) {
+      if (wait || retired_learners_[ii]->done) {
+        retired_learners_[ii]->thread.join();
+        retired_learners_.erase(retired_learners_.begin() + ii);
+      } else {
+        ii++;
+      }
+    }
+  }
+
+  // Run by the background learning thread on a snapshot of the training
+  // data and a clone of the kernel.
+  void GaussianProcess::LearnInBackground(BackgroundLearner* learner,
+                                          const PointSet& points,
+                                          const MatrixXd& targets,
+                                          const Kernel::Ptr& kernel,
+                                          double noise, size_t generation,
+                                          std::promise<bool> promise) {
+    const TrainingLogLikelihood cost(points, targets, kernel, noise);
+    VectorXd parameters = kernel->ImmutableParams();
+
+    // Solve with default settings, and stop early if cancelled.
+    const LearningOptions options;
+    AbortCallback callback(&learner->cancel);
+    const std::vector<IterationCallback*> callbacks(1, &callback);
+    LbfgsSolver lbfgs(parameters.size(), options.lbfgs.rank);
+
+    LbfgsSolver::Summary summary;
+    if (!Minimize(options.solver, options.lbfgs, options.max_iterations, 0.0,
+                  cost, &lbfgs, callbacks, parameters, &summary)) {
+      promise.set_value(false);
+      learner->done = true;
+      return;
+    }
+
+    kernel->Reset(parameters);
+
+    // Catch up with points that were added during optimization. The snapshot
+    // is shared with the cost functor's memoized model, so extend a copy.
+    const size_t num_snapshot = points->size();
+    PointSet all_points = points;
+    {
+      std::lock_guard<std::mutex> lock(learner_mutex_);
+      if (points_->size() > num_snapshot) {
+        all_points.reset(new std::vector<VectorXd>(*points));
+        all_points->insert(all_points->end(),
+                           points_->begin() + num_snapshot, points_->end());
+      }
+    }
+
+    // Compute the new covariance, reusing the cost functor's block if it was
+    // built at the final parameters, and factorize.
+    const size_t N = all_points->size();
+    std::unique_ptr<LearnedHyperparams> learned(new LearnedHyperparams);
+    learned->params = parameters;
+    learned->generation = generation;
+    learned->covariance.Resize(N);
+
+    size_t first_row = 0;
+    const GaussianProcess* cached = cost.CachedProcess(parameters.data());
+    if (cached) {
+      learned->covariance.SetLeadingBlock(cached->covariance_);
+      first_row = num_snapshot;
+    }
+
+    for (size_t ii = first_row; ii < N; ii++) {
+      Eigen::Map<VectorXd> row = learned->covariance.Row(ii);
+      const VectorXd& x = all_points->at(ii);
+      row(ii) = kernel->Evaluate(x, x) + noise;
+
+      for (size_t jj = 0; jj < ii; jj++)
+        row(jj) = kernel->Evaluate(x, all_points->at(jj));
+    }
+
+    if (cached && N == num_snapshot)
+      learned->llt = cached->ImmutableCholesky();
+    else
+      learned->llt.compute(learned->covariance.Dense());
+
+    // Hand off to the owning thread, unless the result is already stale.
+    bool handed_off = false;
+    {
+      std::lock_guard<std::mutex> lock(learner_mutex_);
+      if (generation == hyperparams_generation_) {
+        learned_.swap(learned);
+        learned_ready_ = true;
+        handed_off = true;
+      }
+    }
+
+    promise.set_value(handed_off);
+    learner->done = true;
+  }
+
+  // Recompute covariance, leaving the Cholesky decomposition and regressed
+  // targets for the next query. If 'cached' is non-null it must have been
+  // built with the current kernel parameters, and all three are copied
+  // instead.
+  void GaussianProcess::Refactorize(const GaussianProcess* cached) {
+    const size_t N = points_->size();
+    ModelChanged();
+
+    if (cached) {
+      CHECK_EQ(cached->points_->size(), N);
+      if (!compact_)
+        covariance_ = cached->covariance_;
+
+      // A mixed precision factorization is recomputed from the covariance.
+      if (mixed_)
+        return;
+
+      llt_ = cached->ImmutableCholesky();
+      stale_factorization_ = false;
+
+      // Further outputs are solved at the next query, along with the first.
+      if (extra_targets_.cols() == 0) {
+        regressed_.head(N) = cached->ImmutableRegressedTargets();
+        stale_regressed_ = false;
+      }
+      return;
+    }
+
+    Covariance();
+  }
+
+  // Bring the Cholesky decomposition up to date. Concurrent queries may race
+  // to get here, so check again under the lock. The regressed targets are
+  // marked stale before the factorization is marked fresh, so that a query
+  // never sees a fresh factorization with regressed targets from an old one.
+  void GaussianProcess::Factorize() const {
+    if (!stale_factorization_)
+      return;
+
+    std::lock_guard<std::mutex> lock(factorization_mutex_);
+    if (!stale_factorization_)
+      return;
+
+    if (compact_) {
+      const size_t N = points_->size();
+      llt_.compute(MatrixXd::NullaryExpr(
+        N, N, LowerCovarianceFunctor(*kernel_, *points_, noise_)));
+    } else if (mixed_) {
+      mixed_->Compute(covariance_);
+    } else {
+      llt_.compute(covariance_.Dense());
+    }
+    stale_regressed_ = true;
+    stale_factorization_ = false;
+  }
+
+  // Bring the Cholesky decomposition and regressed targets up to date.
+  void GaussianProcess::Regress() const {
+    Factorize();
+    if (!stale_regressed_)
+      return;
+
+    std::lock_guard<std::mutex> lock(factorization_mutex_);
+    if (!stale_regressed_)
+      return;
+
+    const size_t N = points_->size();
+    if (mixed_)
+      regressed_.head(N) =
+        mixed_->Solve(VectorXd(targets_.head(N)), &refinement_);
+    else
+      regressed_.head(N) = llt_.solve(targets_.head(N));
+
+    // Any further outputs share the factorization, in one multi-column solve.
+    if (extra_targets_.cols() > 0) {
+      const MatrixXd extra = extra_targets_.topRows(N);
+      extra_regressed_.topRows(N) =
+        mixed_ ? mixed_->Solve(extra) : MatrixXd(llt_.solve(extra));
+    }
+    stale_regressed_ = false;
+  }
+
+  // Solve against the covariance with whichever factorization is in use.
+  VectorXd GaussianProcess::Solve(const VectorXd& b) const {
+    Factorize();
+    return mixed_ ? mixed_->Solve(b) : VectorXd(llt_.solve(b));
+  }
+
+  MatrixXd GaussianProcess::Solve(const MatrixXd& b) const {
+    Factorize();
+    return mixed_ ? mixed_->Solve(b) : MatrixXd(llt_.solve(b));
+  }
+
+  double GaussianProcess::LogDeterminant() const {
+    Factorize();
+    if (mixed_)
+      return mixed_->LogDeterminant();
+
+    return 2.0 * llt_.matrixLLT().diagonal().array().log().sum();
+  }
+
+  // Make room for 'size' targets and regressed targets. Capacity at least
+  // doubles each time, so adding points one at a time copies each target a
+  // constant number of times on average.
+  void GaussianProcess::Reserve(size_t size) {
+    const size_t capacity = targets_.size();
+    if (size <= capacity)
+      return;
+
+    const size_t new_capacity =
+      std::min(max_points_, std::max(size, 2 * capacity));
+    targets_.conservativeResize(new_capacity);
+    regressed_.conservativeResize(new_capacity);
+    if (extra_targets_.cols() > 0) {
+      extra_targets_.conservativeResize(new_capacity, Eigen::NoChange);
+      extra_regressed_.conservativeResize(new_capacity, Eigen::NoChange);
+    }
+  }
+
+  // Replace the targets of all outputs, one output per column.
+  void GaussianProcess::SetTargets(const Eigen::Ref<const MatrixXd>& targets) {
+    const size_t N = points_->size();
+    CHECK_EQ(targets.rows(), N);
+    CHECK_GE(targets.cols(), 1);
+    CHECK(!online_ || targets.cols() == 1)
+      << "Online learning only supports a single output.";
+
+    const Eigen::Index capacity = targets_.size();
+    targets_.head(N) = targets.col(0);
+    extra_targets_.resize(capacity, targets.cols() - 1);
+    extra_targets_.topRows(N) = targets.rightCols(targets.cols() - 1);
+    extra_regressed_.resize(capacity, targets.cols() - 1);
+
+    RegressedTargetsChanged();
+  }
+
+  // Targets and regressed targets of all outputs.
+  MatrixXd GaussianProcess::OutputTargets() const {
+    const size_t N = points_->size();
+    MatrixXd targets(N, NumOutputs());
+    targets.col(0) = targets_.head(N);
+    if (extra_targets_.cols() > 0)
+      targets.rightCols(extra_targets_.cols()) = extra_targets_.topRows(N);
+
+    return targets;
+  }
+
+  MatrixXd GaussianProcess::OutputRegressedTargets() const {
+    Regress();
+
+    const size_t N = points_->size();
+    MatrixXd regressed(N, NumOutputs());
+    regressed.col(0) = regressed_.head(N);
+    if (extra_targets_.cols() > 0)
+      regressed.rightCols(extra_targets_.cols()) = extra_regressed_.topRows(N);
+
+    return regressed;
   }
 
   // Compute the covariance and cross covariance against the training points.
+  // Only the lower triangle is stored.
   void GaussianProcess::Covariance() {
+    scaled_points_.Update(*kernel_, *points_);
+    if (compact_)
+      return;
+
+    covariance_.Resize(points_->size());
+
+    VectorXd scaled;
     for (size_t ii = 0; ii < points_->size(); ii++) {
-      covariance_(ii, ii) = 1.0 + noise_;
+      Eigen::Map<VectorXd> row = covariance_.Row(ii);
+      row(ii) = kernel_->Evaluate(points_->at(ii), points_->at(ii)) + noise_;
+      KernelRow(points_->at(ii), row.head(ii), scaled);
+    }
+  }
 
-      for (size_t jj = 0; jj < ii; jj++) {
-        covariance_(ii, jj) =
-          kernel_->Evaluate(points_->at(ii), points_->at(jj));
-        covariance_(jj, ii) = covariance_(ii, jj);
-      }
+  void GaussianProcess::CrossCovariance(const VectorXd& x,
+                                        Eigen::Ref<VectorXd> cross) const {
+    VectorXd projected, scaled;
+    const VectorXd& y = Project(x, projected);
+    KernelRow(y, cross.head(points_->size()), scaled);
+  }
+
+  // Kernel between a projected point and the leading training points, as dot
+  // products against the pre-scaled points when they are current.
+  void GaussianProcess::KernelRow(const VectorXd& y,
+                                  Eigen::Ref<VectorXd> values,
+                                  VectorXd& scaled) const {
+    if (scaled_points_.Current(*kernel_, values.size())) {
+      scaled_points_.Evaluate(y, values, scaled);
+      return;
     }
+
+    for (Eigen::Index ii = 0; ii < values.size(); ii++)
+      values(ii) = kernel_->Evaluate(points_->at(ii), y);
   }
 
-  void GaussianProcess::CrossCovariance(const VectorXd& x, VectorXd& cross) const {
-    for (size_t ii = 0; ii < points_->size(); ii++)
-      cross(ii) = kernel_->Evaluate(points_->at(ii), x);
+  // Cross covariance of a batch of points, one column per point. Large
+  // batches are split by column across the shared thread pool.
+  void GaussianProcess::CrossCovariance(const std::vector<VectorXd>& points,
+                                        size_t first, size_t count,
+                                        MatrixXd& cross) const {
+    CHECK_LE(first + count, points.size());
+    const size_t N = points_->size();
+    const size_t B = count;
+    cross.resize(N, B);
+
+    // Only spread the work over threads if each gets enough of it.
+    const size_t kMinEvaluationsPerThread = 1 << 15;
+    ThreadPool& pool = ThreadPool::Shared();
+    const size_t num_tasks = std::min(std::min(pool.NumThreads(), B),
+                                      N * B / kMinEvaluationsPerThread);
+
+    if (num_tasks <= 1) {
+      for (size_t ii = 0; ii < B; ii++)
+        CrossCovariance(points[first + ii], cross.col(ii));
+
+      return;
+    }
+
+    pool.ParallelFor(num_tasks, [&](size_t tt) {
+      for (size_t ii = tt; ii < B; ii += num_tasks)
+        CrossCovariance(points[first + ii], cross.col(ii));
+    });
+  }
+
+  // Drop pruned dimensions from an input point.
+  const VectorXd& GaussianProcess::Project(const VectorXd& x,
+                                           VectorXd& projected) const {
+    CHECK_EQ(x.size(), dimension_);
+    if (relevant_.size() == dimension_)
+      return x;
+
+    projected.resize(relevant_.size());
+    for (size_t ii = 0; ii < relevant_.size(); ii++)
+      projected(ii) = x(relevant_[ii]);
+
+    return projected;
   }
 }  //\namespace gp
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the GridTable class, which stores the mean and variance of a GP at
+// the nodes of a regular grid and interpolates between them.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/grid_table.hpp>
+
+#include <algorithm>
+#include <math.h>
+
+namespace gp {
+
+  const size_t GridTable::kMaxDimension;
+
+  GridTable::GridTable(const VectorXd& lower, const VectorXd& upper,
+                       size_t resolution, InterpolationType interpolation,
+                       const VectorXd& means, const VectorXd& variances)
+    : lower_(lower),
+      upper_(upper),
+      resolution_(resolution),
+      interpolation_(interpolation),
+      means_(means),
+      variances_(variances) {
+    const size_t D = lower_.size();
+    CHECK_GE(D, 1);
+    CHECK_LE(D, kMaxDimension);
+    CHECK_EQ(upper_.size(), D);
+    CHECK_GE(resolution_, 2);
+    CHECK_EQ(means_.size(), variances_.size());
+    CHECK((upper_.array() > lower_.array()).all());
+    if (interpolation_ == CUBIC)
+      CHECK_GE(resolution_, 3);
+
+    spacing_ = (upper_ - lower_) / static_cast<double>(resolution_ - 1);
+
+    size_t stride = 1;
+    for (size_t ii = 0; ii < D; ii++) {
+      strides_[ii] = stride;
+      stride *= resolution_;
+    }
+
+    CHECK_EQ(means_.size(), stride);
+  }
+
+  // Interpolate as a tensor product of one dimensional stencils: two nodes
+  // with linear weights, or four with Catmull-Rom weights.
+  void GridTable::Evaluate(const VectorXd& x,
+                           double& mean, double& variance) const {
+    const size_t D = lower_.size();
+    CHECK_EQ(x.size(), D);
+
+    const size_t taps = (interpolation_ == CUBIC) ? 4 : 2;
+    size_t offsets[kMaxDimension][4];
+    double weights[kMaxDimension][4];
+
+    for (size_t ii = 0; ii < D; ii++) {
+      // Cell containing the point, and position within it.
+      const double scaled = (x(ii) - lower_(ii)) / spacing_(ii);
+      const double cell = std::min(std::max(std::floor(scaled), 0.0),
+                                   static_cast<double>(resolution_ - 2));
+      const double t = std::min(std::max(scaled - cell, 0.0), 1.0);
+      const int first = static_cast<int>(cell);
+
+      if (interpolation_ == LINEAR) {
+        offsets[ii][0] = first * strides_[ii];
+        offsets[ii][1] = (first + 1) * strides_[ii];
+        weights[ii][0] = 1.0 - t;
+        weights[ii][1] = t;
+        continue;
+      }
+
+      const int last = static_cast<int>(resolution_) - 1;
+      for (int jj = 0; jj < 4; jj++) {
+        const int node = std::min(std::max(first - 1 + jj, 0), last);
+        offsets[ii][jj] = node * strides_[ii];
+      }
+
+      const double t2 = t * t;
+      const double t3 = t2 * t;
+      double* w = weights[ii];
+      w[0] = 0.5 * (-t3 + 2.0 * t2 - t);
+      w[1] = 0.5 * (3.0 * t3 - 5.0 * t2 + 2.0);
+      w[2] = 0.5 * (-3.0 * t3 + 4.0 * t2 + t);
+      w[3] = 0.5 * (t3 - t2);
+
+      // Nodes beyond the edges are extrapolated quadratically from the three
+      // nearest ones, so boundary cells stay as accurate as interior ones.
+      if (first == 0) {
+        w[1] += 3.0 * w[0];
+        w[2] -= 3.0 * w[0];
+        w[3] += w[0];
+        w[0] = 0.0;
+      }
+
+      if (first + 1 == last) {
+        w[0] += w[3];
+        w[1] -= 3.0 * w[3];
+        w[2] += 3.0 * w[3];
+        w[3] = 0.0;
+      }
+    }
+
+    // Sum over all combinations of stencil nodes.
+    size_t num_terms = 1;
+    for (size_t ii = 0; ii < D; ii++)
+      num_terms *= taps;
+
+    mean = 0.0;
+    variance = 0.0;
+    for (size_t term = 0; term < num_terms; term++) {
+      size_t index = 0;
+      double weight = 1.0;
+
+      size_t remainder = term;
+      for (size_t ii = 0; ii < D; ii++) {
+        const size_t tap = remainder % taps;
+        remainder /= taps;
+
+        index += offsets[ii][tap];
+        weight *= weights[ii][tap];
+      }
+
+      mean += weight * means_(index);
+      variance += weight * variances_(index);
+    }
+
+    // Cubic interpolation can overshoot below zero.
+    variance = std::max(variance, 0.0);
+  }
+
+}  //\namespace gp
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the MultiTaskProcess class, an intrinsic coregionalization model
+// (ICM) with covariance B (x) K + noise * I. Fully observed targets are solved
+// through the Kronecker eigendecomposition, and partially observed ones with
+// conjugate gradients.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/multi_task_process.hpp>
+#include <optimization/cost_functors.hpp>
+#include <optimization/lbfgs_solver.hpp>
+
+#include <Eigen/Eigenvalues>
+#include <math.h>
+
+namespace gp {
+
+  MultiTaskProcess::MultiTaskProcess(const Kernel::Ptr& kernel,
+                                     const MatrixXd& task_covariance,
+                                     double noise, const PointSet& points,
+                                     const MatrixXd& targets,
+                                     const MultiTaskOptions& options)
+    : kernel_(kernel),
+      task_covariance_(task_covariance),
+      noise_(noise),
+      points_(points),
+      targets_(targets),
+      options_(options) {
+    CHECK_NOTNULL(kernel_.get());
+    CHECK_NOTNULL(points_.get());
+    CHECK_GE(points_->size(), 1);
+    CHECK_EQ(targets_.rows(), points_->size());
+    CHECK_GE(targets_.cols(), 1);
+    CHECK_EQ(task_covariance_.rows(), targets_.cols());
+    CHECK_EQ(task_covariance_.cols(), targets_.cols());
+    CHECK_GT(noise_, 0.0);
+
+    // Note which targets are observed, unless all of them are.
+    if (targets_.hasNaN()) {
+      for (Eigen::Index ii = 0; ii < targets_.size(); ii++) {
+        if (!std::isnan(targets_(ii)))
+          observed_.push_back(ii);
+      }
+
+      CHECK(!observed_.empty()) << "No targets are observed.";
+    }
+
+    Factorize();
+  }
+
+  // Evaluate the mean and variance of every task at a point.
+  void MultiTaskProcess::Evaluate(const VectorXd& x, VectorXd& means,
+                                  VectorXd& variances) const {
+    const size_t N = NumPoints();
+    const size_t T = NumTasks();
+
+    VectorXd cross(N);
+    for (size_t ii = 0; ii < N; ii++)
+      cross(ii) = kernel_->Evaluate(x, points_->at(ii));
+
+    const double prior = kernel_->Evaluate(x, x);
+
+    // The cross covariance against task s at the ii'th point is
+    // B(s, t) cross(ii), so the mean of task t is row t of B R^T cross.
+    means = task_covariance_ * (regressed_.transpose() * cross);
+
+    if (FullyObserved()) {
+      // Project the cross covariance onto the point eigenvectors, after which
+      // the solve is diagonal.
+      const VectorXd projected = point_eigenvectors_.transpose() * cross;
+      const VectorXd weights =
+        eigenvalues_.cwiseInverse().transpose() * projected.cwiseAbs2();
+
+      variances = prior * task_covariance_.diagonal() -
+        task_eigenvectors_.cwiseAbs2() *
+        weights.cwiseProduct(task_eigenvalues_.cwiseAbs2());
+      return;
+    }
+
+    // With missing targets, each task needs its own solve.
+    variances.resize(T);
+    VectorXd column, solved;
+    for (size_t tt = 0; tt < T; tt++) {
+      Gather(cross * task_covariance_.row(tt), column);
+      Solve(column, solved);
+      variances(tt) =
+        prior * task_covariance_(tt, tt) - column.dot(solved);
+    }
+  }
+
+  // Cost (twice the negative log-likelihood, up to a constant).
+  double MultiTaskProcess::Cost() const {
+    CHECK(FullyObserved()) << "Cost needs every target to be observed.";
+
+    return targets_.cwiseProduct(regressed_).sum() +
+      eigenvalues_.array().log().sum();
+  }
+
+  // With D the eigenvalues of the full covariance, R the regressed targets,
+  // and l and m the point and task eigenvalues, the trace terms of the
+  // gradient reduce to
+  //   tr(inv(C) (E_st (x) K)) = (V diag(w) V^T)_st, w_s = sum_i l_i / D_is,
+  //   tr(inv(C) (B (x) dK)) = sum(U diag(v) U^T .* dK), v_i = sum_s m_s / D_is,
+  // and the quadratic terms to (R^T K R)_st and sum(R B R^T .* dK).
+  void MultiTaskProcess::Gradient(VectorXd& kernel_gradient,
+                                  MatrixXd& task_gradient) const {
+    CHECK(FullyObserved()) << "Gradient needs every target to be observed.";
+    const size_t N = NumPoints();
+
+    const MatrixXd inverse = eigenvalues_.cwiseInverse();
+    const VectorXd task_weights = inverse.transpose() * point_eigenvalues_;
+    const VectorXd point_weights = inverse * task_eigenvalues_;
+
+    task_gradient = task_eigenvectors_ * task_weights.asDiagonal() *
+      task_eigenvectors_.transpose();
+    task_gradient.noalias() -=
+      regressed_.transpose() * covariance_ * regressed_;
+
+    MatrixXd weights = point_eigenvectors_ * point_weights.asDiagonal() *
+      point_eigenvectors_.transpose();
+    weights.noalias() -=
+      regressed_ * task_covariance_ * regressed_.transpose();
+
+    // Accumulate over all pairs, using symmetry of dK.
+    kernel_gradient = VectorXd::Zero(kernel_->ImmutableParams().size());
+    VectorXd pair_gradient;
+    for (size_t ii = 0; ii < N; ii++) {
+      const VectorXd& x = points_->at(ii);
+
+      kernel_->Gradient(x, x, pair_gradient);
+      kernel_gradient += weights(ii, ii) * pair_gradient;
+
+      for (size_t jj = 0; jj < ii; jj++) {
+        kernel_->Gradient(x, points_->at(jj), pair_gradient);
+        kernel_gradient += 2.0 * weights(ii, jj) * pair_gradient;
+      }
+    }
+  }
+
+  // Learn the kernel parameters and task covariance.
+  bool MultiTaskProcess::LearnHyperparams(const LbfgsOptions& options,
+                                          size_t max_iterations) {
+    CHECK(FullyObserved()) << "Learning needs every target to be observed.";
+
+    // Optimize over a clone of the kernel, so that the model's own kernel is
+    // only touched once learning is done.
+    const Kernel::Ptr kernel = kernel_->Clone();
+    const MultiTaskLogLikelihood cost(points_, targets_, kernel, noise_);
+    VectorXd parameters = cost.Pack(task_covariance_);
+
+    LbfgsSolver lbfgs(parameters.size(), options.rank);
+    LbfgsSolver::Summary summary;
+    if (!lbfgs.Solve(cost, options, max_iterations,
+                     std::vector<IterationCallback*>(), parameters, &summary))
+      return false;
+
+    // Install, reusing the cost functor's factorization when possible.
+    const size_t P = kernel_->ImmutableParams().size();
+    kernel_->Reset(parameters.head(P));
+    task_covariance_ = cost.TaskCovariance(parameters.data());
+
+    const MultiTaskProcess* cached = cost.CachedProcess(parameters.data());
+    if (!cached) {
+      Factorize();
+      return true;
+    }
+
+    covariance_ = cached->covariance_;
+    regressed_ = cached->regressed_;
+    point_eigenvectors_ = cached->point_eigenvectors_;
+    point_eigenvalues_ = cached->point_eigenvalues_;
+    task_eigenvectors_ = cached->task_eigenvectors_;
+    task_eigenvalues_ = cached->task_eigenvalues_;
+    eigenvalues_ = cached->eigenvalues_;
+    return true;
+  }
+
+  // Recompute the covariance and the regressed targets.
+  void MultiTaskProcess::Factorize() {
+    const size_t N = NumPoints();
+
+    covariance_.resize(N, N);
+    for (size_t ii = 0; ii < N; ii++) {
+      for (size_t jj = 0; jj <= ii; jj++) {
+        covariance_(ii, jj) =
+          kernel_->Evaluate(points_->at(ii), points_->at(jj));
+        covariance_(jj, ii) = covariance_(ii, jj);
+      }
+    }
+
+    if (FullyObserved()) {
+      // Eigendecompose both factors. Round-off can leave tiny negative
+      // eigenvalues.
+      Eigen::SelfAdjointEigenSolver<MatrixXd> point_solver(covariance_);
+      CHECK_EQ(point_solver.info(), Eigen::Success);
+      point_eigenvectors_ = point_solver.eigenvectors();
+      point_eigenvalues_ = point_solver.eigenvalues().cwiseMax(0.0);
+
+      Eigen::SelfAdjointEigenSolver<MatrixXd> task_solver(task_covariance_);
+      CHECK_EQ(task_solver.info(), Eigen::Success);
+      task_eigenvectors_ = task_solver.eigenvectors();
+      task_eigenvalues_ = task_solver.eigenvalues().cwiseMax(0.0);
+
+      eigenvalues_ = point_eigenvalues_ * task_eigenvalues_.transpose();
+      eigenvalues_.array() += noise_;
+
+      // Rotate the targets into the joint eigenbasis, scale, and rotate back.
+      regressed_ = point_eigenvectors_ *
+        (point_eigenvectors_.transpose() * targets_ * task_eigenvectors_)
+        .cwiseQuotient(eigenvalues_) * task_eigenvectors_.transpose();
+      return;
+    }
+
+    // Jacobi preconditioner.
+    diagonal_.resize(observed_.size());
+    for (size_t ii = 0; ii < observed_.size(); ii++) {
+      const Eigen::Index point = observed_[ii] % N;
+      const Eigen::Index task = observed_[ii] / N;
+      diagonal_(ii) = task_covariance_(task, task) *
+        covariance_(point, point) + noise_;
+    }
+
+    VectorXd observed_targets, solved;
+    Gather(targets_, observed_targets);
+    Solve(observed_targets, solved);
+    Scatter(solved, regressed_);
+  }
+
+  // Multiply a vector over the observed targets by their covariance. Scattered
+  // into an N x T matrix V, the product with B (x) K is K V B.
+  void MultiTaskProcess::Multiply(const VectorXd& v, VectorXd& product) const {
+    MatrixXd scattered;
+    Scatter(v, scattered);
+    Gather(covariance_ * scattered * task_covariance_, product);
+    product += noise_ * v;
+  }
+
+  // Solve with Jacobi-preconditioned conjugate gradients.
+  void MultiTaskProcess::Solve(const VectorXd& b, VectorXd& solution) const {
+    solution = VectorXd::Zero(b.size());
+
+    VectorXd residual = b;
+    VectorXd preconditioned = residual.cwiseQuotient(diagonal_);
+    VectorXd direction = preconditioned;
+    VectorXd product;
+    double inner = residual.dot(preconditioned);
+
+    const double threshold = options_.cg_tolerance * b.norm();
+    for (size_t ii = 0; ii < options_.max_cg_iterations; ii++) {
+      if (residual.norm() <= threshold)
+        break;
+
+      Multiply(direction, product);
+      const double step = inner / direction.dot(product);
+      solution += step * direction;
+      residual -= step * product;
+
+      preconditioned = residual.cwiseQuotient(diagonal_);
+      const double next_inner = residual.dot(preconditioned);
+      direction = preconditioned + (next_inner / inner) * direction;
+      inner = next_inner;
+    }
+  }
+
+  // Scatter a vector over the observed targets into an N x T matrix, and
+  // gather it back.
+  void MultiTaskProcess::Scatter(const VectorXd& v, MatrixXd& matrix) const {
+    CHECK_EQ(v.size(), observed_.size());
+    matrix = MatrixXd::Zero(NumPoints(), NumTasks());
+    for (size_t ii = 0; ii < observed_.size(); ii++)
+      matrix(observed_[ii]) = v(ii);
+  }
+
+  void MultiTaskProcess::Gather(const MatrixXd& matrix, VectorXd& v) const {
+    v.resize(observed_.size());
+    for (size_t ii = 0; ii < observed_.size(); ii++)
+      v(ii) = matrix(observed_[ii]);
+  }
+
+}  //\namespace gp
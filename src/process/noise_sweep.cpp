@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the NoiseSweep class, which eigendecomposes the noise-free
+// covariance of a set of training points once so that the log-likelihood,
+// regressed targets, and predictions can be computed cheaply for any noise
+// variance. With K = Q diag(l) Q^T, (K + s I)^-1 = Q diag(1 / (l + s)) Q^T.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/noise_sweep.hpp>
+
+#include <Eigen/Eigenvalues>
+#include <math.h>
+
+namespace gp {
+
+  NoiseSweep::NoiseSweep(const Kernel::Ptr& kernel, const PointSet& points,
+                         const VectorXd& targets)
+    : kernel_(kernel->Clone()),
+      points_(points) {
+    CHECK_NOTNULL(points_.get());
+    CHECK_GE(targets.size(), 1);
+    CHECK_LE(targets.size(), points_->size());
+
+    // Compute the noise-free covariance (lower triangle only).
+    const size_t N = targets.size();
+    MatrixXd covariance(N, N);
+    for (size_t ii = 0; ii < N; ii++) {
+      for (size_t jj = 0; jj <= ii; jj++)
+        covariance(ii, jj) =
+          kernel_->Evaluate(points_->at(ii), points_->at(jj));
+    }
+
+    // Eigendecompose. Round-off can leave tiny negative eigenvalues.
+    Eigen::SelfAdjointEigenSolver<MatrixXd> solver(covariance);
+    CHECK_EQ(solver.info(), Eigen::Success);
+
+    eigenvectors_ = solver.eigenvectors();
+    eigenvalues_ = solver.eigenvalues().cwiseMax(0.0);
+    projected_targets_ = eigenvectors_.transpose() * targets;
+  }
+
+  // Cost (twice the negative log-likelihood, up to a constant) and its
+  // derivative with respect to the noise variance.
+  double NoiseSweep::Cost(double noise) const {
+    CHECK_GT(noise, 0.0);
+
+    double cost = 0.0;
+    for (size_t ii = 0; ii < NumPoints(); ii++) {
+      const double lambda = eigenvalues_(ii) + noise;
+      cost += projected_targets_(ii) * projected_targets_(ii) / lambda +
+        std::log(lambda);
+    }
+
+    return cost;
+  }
+
+  double NoiseSweep::CostDerivative(double noise) const {
+    CHECK_GT(noise, 0.0);
+
+    double derivative = 0.0;
+    for (size_t ii = 0; ii < NumPoints(); ii++) {
+      const double inv_lambda = 1.0 / (eigenvalues_(ii) + noise);
+      derivative += inv_lambda - projected_targets_(ii) *
+        projected_targets_(ii) * inv_lambda * inv_lambda;
+    }
+
+    return derivative;
+  }
+
+  void NoiseSweep::Cost(const VectorXd& noises, VectorXd& costs) const {
+    costs.resize(noises.size());
+    for (Eigen::Index ii = 0; ii < noises.size(); ii++)
+      costs(ii) = Cost(noises(ii));
+  }
+
+  // Noise variance with the lowest cost.
+  double NoiseSweep::BestNoise(const NoiseOptions& options) const {
+    CHECK_GT(options.min_noise, 0.0);
+    CHECK_GE(options.max_noise, options.min_noise);
+    CHECK_GE(options.num_grid, 2);
+
+    // Log-spaced grid.
+    const VectorXd log_noises = VectorXd::LinSpaced(
+      options.num_grid, std::log(options.min_noise),
+      std::log(options.max_noise));
+
+    size_t best = 0;
+    double best_cost = Cost(std::exp(log_noises(0)));
+    for (size_t ii = 1; ii < options.num_grid; ii++) {
+      const double cost = Cost(std::exp(log_noises(ii)));
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = ii;
+      }
+    }
+
+    // Golden section search between the neighbors of the best grid point.
+    const double kInvPhi = 0.5 * (std::sqrt(5.0) - 1.0);
+    double lower = log_noises(best > 0 ? best - 1 : best);
+    double upper = log_noises(best + 1 < options.num_grid ? best + 1 : best);
+
+    double left = upper - kInvPhi * (upper - lower);
+    double right = lower + kInvPhi * (upper - lower);
+    double left_cost = Cost(std::exp(left));
+    double right_cost = Cost(std::exp(right));
+    for (size_t ii = 0; ii < options.num_refinements; ii++) {
+      if (left_cost < right_cost) {
+        upper = right;
+        right = left;
+        right_cost = left_cost;
+        left = upper - kInvPhi * (upper - lower);
+        left_cost = Cost(std::exp(left));
+      } else {
+        lower = left;
+        left = right;
+        left_cost = right_cost;
+        right = lower + kInvPhi * (upper - lower);
+        right_cost = Cost(std::exp(right));
+      }
+    }
+
+    // Never return anything worse than the best grid point.
+    const double refined = (left_cost < right_cost) ? left : right;
+    if (std::min(left_cost, right_cost) < best_cost)
+      return std::exp(refined);
+
+    return std::exp(log_noises(best));
+  }
+
+  // Regressed targets (inv(cov) * targets).
+  void NoiseSweep::RegressedTargets(double noise, VectorXd& regressed) const {
+    CHECK_GT(noise, 0.0);
+
+    regressed = eigenvectors_ *
+      (projected_targets_.array() / (eigenvalues_.array() + noise)).matrix();
+  }
+
+  // Mean and variance at a point.
+  void NoiseSweep::Evaluate(const VectorXd& x, double noise,
+                            double& mean, double& variance) const {
+    VectorXd means, variances;
+    Evaluate(x, VectorXd::Constant(1, noise), means, variances);
+
+    mean = means(0);
+    variance = variances(0);
+  }
+
+  void NoiseSweep::Evaluate(const VectorXd& x, const VectorXd& noises,
+                            VectorXd& means, VectorXd& variances) const {
+    // Project the cross covariance onto the eigenvectors.
+    VectorXd cross(NumPoints());
+    for (size_t ii = 0; ii < NumPoints(); ii++)
+      cross(ii) = kernel_->Evaluate(x, points_->at(ii));
+
+    const VectorXd projected = eigenvectors_.transpose() * cross;
+    const double prior = kernel_->Evaluate(x, x);
+
+    means.resize(noises.size());
+    variances.resize(noises.size());
+    for (Eigen::Index ii = 0; ii < noises.size(); ii++) {
+      CHECK_GT(noises(ii), 0.0);
+
+      const Eigen::ArrayXd inv_lambda =
+        (eigenvalues_.array() + noises(ii)).inverse();
+      means(ii) = (projected.array() * projected_targets_.array() *
+                   inv_lambda).sum();
+      variances(ii) = prior -
+        (projected.array().square() * inv_lambda).sum();
+    }
+  }
+
+}  //\namespace gp
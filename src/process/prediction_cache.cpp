@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the PredictionCache class, a bounded least-recently-used cache of
+// per-query-point results keyed by the point itself.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/prediction_cache.hpp>
+
+#include <functional>
+
+namespace gp {
+
+  PredictionCache::PredictionCache(size_t capacity)
+    : capacity_(capacity) {
+    CHECK_GE(capacity_, 1);
+    entries_.reserve(capacity_);
+  }
+
+  // Entry for this point if there is one for the given model generation.
+  PredictionCache::Entry* PredictionCache::Find(const VectorXd& x,
+                                                size_t generation) {
+    Map::iterator it = entries_.find(x);
+    if (it == entries_.end()) {
+      statistics_.misses++;
+      return NULL;
+    }
+
+    if (it->second.generation != generation) {
+      Erase(it);
+      statistics_.misses++;
+      return NULL;
+    }
+
+    // Move to the front.
+    order_.splice(order_.begin(), order_, it->second.position);
+    statistics_.hits++;
+    return &it->second.entry;
+  }
+
+  // Fresh entry for this point and model generation.
+  PredictionCache::Entry* PredictionCache::Insert(const VectorXd& x,
+                                                  size_t generation) {
+    Map::iterator it = entries_.find(x);
+    if (it != entries_.end()) {
+      order_.splice(order_.begin(), order_, it->second.position);
+    } else {
+      if (entries_.size() >= capacity_) {
+        Erase(entries_.find(*order_.back()));
+        statistics_.evictions++;
+      }
+
+      it = entries_.insert(std::make_pair(x, Slot())).first;
+      order_.push_front(&it->first);
+      it->second.position = order_.begin();
+    }
+
+    it->second.entry = Entry();
+    it->second.generation = generation;
+    return &it->second.entry;
+  }
+
+  // Drop all entries.
+  void PredictionCache::Clear() {
+    entries_.clear();
+    order_.clear();
+  }
+
+  // Remove an entry.
+  void PredictionCache::Erase(Map::iterator it) {
+    order_.erase(it->second.position);
+    entries_.erase(it);
+  }
+
+  // Combine the hashes of all coordinates.
+  size_t PredictionCache::PointHash::operator()(const VectorXd& x) const {
+    const std::hash<double> hash;
+
+    size_t seed = static_cast<size_t>(x.size());
+    for (int ii = 0; ii < x.size(); ii++)
+      seed ^= hash(x(ii)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+    return seed;
+  }
+
+}  //\namespace gp
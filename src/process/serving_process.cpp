@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Defines the ServingProcess class template, a read-only copy of a trained
+// GaussianProcess that evaluates in the given scalar type.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <process/serving_process.hpp>
+
+namespace gp {
+
+namespace {
+  // Kernel evaluation in each supported scalar type.
+  float EvaluateKernel(const Kernel& kernel,
+                       const VectorXf& x, const VectorXf& y) {
+    return kernel.EvaluateSingle(x, y);
+  }
+
+  double EvaluateKernel(const Kernel& kernel,
+                        const VectorXd& x, const VectorXd& y) {
+    return kernel.Evaluate(x, y);
+  }
+} //\namespace
+
+  template <typename Scalar>
+  ServingProcess<Scalar>::ServingProcess(const Kernel::ConstPtr& kernel,
+                                         size_t dimension,
+                                         const std::vector<size_t>& relevant,
+                                         const std::vector<VectorXd>& points,
+                                         const VectorXd& regressed,
+                                         const MatrixXd& cholesky)
+    : kernel_(kernel),
+      dimension_(dimension),
+      relevant_(relevant) {
+    CHECK_NOTNULL(kernel_.get());
+    CHECK_GE(points.size(), 1);
+    CHECK_LE(relevant_.size(), dimension_);
+    CHECK_EQ(regressed.size(), points.size());
+    CHECK_EQ(cholesky.rows(), points.size());
+    CHECK_EQ(cholesky.cols(), points.size());
+
+    // Convert everything to the serving scalar type.
+    points_.reserve(points.size());
+    for (size_t ii = 0; ii < points.size(); ii++) {
+      CHECK_EQ(points[ii].size(), relevant_.size());
+      points_.push_back(points[ii].template cast<Scalar>());
+    }
+
+    regressed_ = regressed.template cast<Scalar>();
+    cholesky_ = cholesky.template cast<Scalar>();
+    cholesky_.template triangularView<Eigen::StrictlyUpper>().setZero();
+  }
+
+  // Evaluate mean and variance at a point. With L the Cholesky factor and k
+  // the cross covariance, the variance is k(x, x) - |inv(L) * k|^2.
+  template <typename Scalar>
+  void ServingProcess<Scalar>::Evaluate(const Vector& x, Scalar& mean,
+                                        Scalar& variance) const {
+    Vector projected;
+    const Vector& y = Project(x, projected);
+
+    Vector cross(points_.size());
+    for (size_t ii = 0; ii < points_.size(); ii++)
+      cross(ii) = EvaluateKernel(*kernel_, points_[ii], y);
+
+    mean = cross.dot(regressed_);
+
+    cholesky_.template triangularView<Eigen::Lower>().solveInPlace(cross);
+    variance = EvaluateKernel(*kernel_, y, y) - cross.squaredNorm();
+  }
+
+  // Evaluate mean and variance at a batch of points, with a single
+  // triangular solve.
+  template <typename Scalar>
+  void ServingProcess<Scalar>::Evaluate(const std::vector<Vector>& points,
+                                        Vector& means,
+                                        Vector& variances) const {
+    const size_t B = points.size();
+    means.resize(B);
+    variances.resize(B);
+
+    Matrix cross(points_.size(), B);
+    Vector projected;
+    for (size_t jj = 0; jj < B; jj++) {
+      const Vector& y = Project(points[jj], projected);
+      for (size_t ii = 0; ii < points_.size(); ii++)
+        cross(ii, jj) = EvaluateKernel(*kernel_, points_[ii], y);
+
+      variances(jj) = EvaluateKernel(*kernel_, y, y);
+    }
+
+    means.noalias() = cross.transpose() * regressed_;
+
+    cholesky_.template triangularView<Eigen::Lower>().solveInPlace(cross);
+    variances -= cross.colwise().squaredNorm().transpose();
+  }
+
+  // Drop pruned dimensions from an input point.
+  template <typename Scalar>
+  const typename ServingProcess<Scalar>::Vector& ServingProcess<Scalar>::
+  Project(const Vector& x, Vector& projected) const {
+    CHECK_EQ(x.size(), dimension_);
+    if (relevant_.size() == dimension_)
+      return x;
+
+    projected.resize(relevant_.size());
+    for (size_t ii = 0; ii < relevant_.size(); ii++)
+      projected(ii) = x(relevant_[ii]);
+
+    return projected;
+  }
+
+  // Supported scalar types.
+  template class ServingProcess<float>;
+  template class ServingProcess<double>;
+
+}  //\namespace gp
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for evaluating with a reusable workspace. Heap allocations are
+// counted by interposing malloc, which both operator new and Eigen's
+// allocator go through; this needs glibc, so elsewhere the tests are left
+// out.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef __GLIBC__
+
+namespace {
+  // Only allocations made while counting is switched on are counted.
+  std::atomic<bool> counting(false);
+  std::atomic<size_t> num_allocations(0);
+
+  void CountAllocation() {
+    if (counting)
+      num_allocations++;
+  }
+} //\namespace
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+
+  void* malloc(size_t size) {
+    CountAllocation();
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t count, size_t size) {
+    CountAllocation();
+    return __libc_calloc(count, size);
+  }
+
+  void* realloc(void* ptr, size_t size) {
+    CountAllocation();
+    return __libc_realloc(ptr, size);
+  }
+} //\extern "C"
+
+namespace gp {
+namespace test {
+
+// Check that evaluating with a workspace matches plain evaluation, and that
+// once the workspace has been sized it performs no allocations at all.
+TEST(GaussianProcess, TestWorkspaceEvaluateDoesNotAllocate) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 200;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-10;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+    targets(ii) = std::sin(points->back().sum());
+  }
+
+  std::vector<VectorXd> test_points;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    test_points.push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  // Warm up the workspace, the factorization, and the regressed targets.
+  GaussianProcess::Workspace workspace;
+  double mean, variance;
+  gp.Evaluate(test_points.front(), mean, variance, workspace);
+
+  // Evaluate in steady state, and only then check the results.
+  VectorXd means(kNumTestPoints), variances(kNumTestPoints);
+  num_allocations = 0;
+  counting = true;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    gp.Evaluate(test_points[ii], means(ii), variances(ii), workspace);
+  counting = false;
+
+  EXPECT_EQ(num_allocations, 0);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    gp.Evaluate(test_points[ii], mean, variance);
+    EXPECT_NEAR(means(ii), mean, kMaxError);
+    EXPECT_NEAR(variances(ii), variance, kMaxError);
+  }
+}
+
+// Check that the kernel itself evaluates without allocating.
+TEST(RbfKernel, TestEvaluateDoesNotAllocate) {
+  const size_t kDimension = 5;
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  const VectorXd x = VectorXd::Random(kDimension);
+  const VectorXd y = VectorXd::Random(kDimension);
+  const VectorXf x_single = x.cast<float>();
+  const VectorXf y_single = y.cast<float>();
+
+  num_allocations = 0;
+  counting = true;
+  const double value = kernel->Evaluate(x, y);
+  const float value_single = kernel->EvaluateSingle(x_single, y_single);
+  counting = false;
+
+  EXPECT_EQ(num_allocations, 0);
+  EXPECT_NEAR(value, value_single, 1e-5);
+}
+
+} //\namespace test
+} //\namespace gp
+
+#endif
@@ -47,6 +47,7 @@
 #include <gtest/gtest.h>
 #include <gflags/gflags.h>
 #include <random>
+#include <thread>
 #include <vector>
 #include <math.h>
 
@@ -118,8 +119,7 @@ TEST(GaussianProcess, TestFunctionApprox1D) {
     }
 
     // Update parameters.
-    mse = gp.UpdateTargets(batch_points, batch_targets,
-                           kStepSize, ii == kGradUpdates - 1);
+    mse = gp.UpdateTargets(batch_points, batch_targets, kStepSize);
 
     if (FLAGS_verbose && ii % 100 == 1)
       std::printf("MSE at step %zu was %5.3f.\n", ii, mse);
@@ -159,5 +159,146 @@ TEST(GaussianProcess, TestFunctionApprox1D) {
   }
 }
 
+// Check that Adam steps on the targets reach the same accuracy in far fewer
+// updates than plain gradient steps.
+TEST(GaussianProcess, TestFunctionApprox1DAdam) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 100;
+  const double kMaxRmsError = 0.01;
+  const double kNoiseVariance = 1e-3;
+  const double kLength = 0.1;
+
+  const size_t kBatchSize = 16;
+  const size_t kGradUpdates = 1000;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = unif(rng);
+  }
+
+  // Train a GP.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, kLength));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  StepOptions options;
+  options.rule = ADAM;
+  options.learning_rate = 0.02;
+  options.decay = 0.01;
+
+  // Run Adam.
+  std::vector<VectorXd> batch_points;
+  std::vector<double> batch_targets;
+  for (size_t ii = 0; ii < kGradUpdates; ii++) {
+    batch_points.clear();
+    batch_targets.clear();
+
+    for (size_t jj = 0; jj < kBatchSize; jj++) {
+      const double x = unif(rng);
+      batch_points.push_back(VectorXd::Constant(1, x));
+      batch_targets.push_back(BumpyParabola(x));
+    }
+
+    const double mse = gp.UpdateTargets(batch_points, batch_targets, options);
+
+    if (FLAGS_verbose && ii % 100 == 1)
+      std::printf("MSE at step %zu was %5.3f.\n", ii, mse);
+  }
+
+  // Test that we have approximated the function well.
+  double squared_error = 0.0;
+  double mean, variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const double x = unif(rng);
+
+    gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+  }
+
+  EXPECT_LE(std::sqrt(squared_error / static_cast<double>(kNumTestPoints)),
+            kMaxRmsError);
+}
+
+// Check that a burst of additions and target updates, followed by concurrent
+// queries, agrees with a GP built from scratch on the final data.
+TEST(GaussianProcess, TestLazyRefactorization) {
+  const size_t kDimension = 2;
+  const size_t kNumInitialPoints = 10;
+  const size_t kNumAddedPoints = 20;
+  const size_t kNumUpdates = 5;
+  const size_t kNumThreads = 4;
+  const size_t kNumTestPoints = 50;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-8;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumInitialPoints);
+  for (size_t ii = 0; ii < kNumInitialPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = points->back().sum();
+  }
+
+  const VectorXd lengths = VectorXd::Constant(kDimension, 0.5);
+  GaussianProcess gp(RbfKernel::Create(lengths), kNoiseVariance, points,
+                     targets, kNumInitialPoints + kNumAddedPoints);
+
+  for (size_t ii = 0; ii < kNumAddedPoints; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    EXPECT_TRUE(gp.Add(x, x.prod()));
+  }
+
+  std::vector<VectorXd> batch_points;
+  std::vector<double> batch_targets;
+  for (size_t ii = 0; ii < kNumUpdates; ii++) {
+    batch_points.push_back(VectorXd::Random(kDimension));
+    batch_targets.push_back(std::sin(batch_points.back().sum()));
+    gp.UpdateTargets(batch_points, batch_targets, 0.1);
+  }
+
+  const size_t N = gp.ImmutablePoints()->size();
+  const PointSet reference_points(
+    new std::vector<VectorXd>(*gp.ImmutablePoints()));
+  const GaussianProcess reference(RbfKernel::Create(lengths), kNoiseVariance,
+                                  reference_points,
+                                  gp.ImmutableTargets().head(N), N);
+
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(kDimension));
+
+  // The first queries race to factorize.
+  std::vector<VectorXd> means(kNumThreads, VectorXd(kNumTestPoints));
+  std::vector<VectorXd> variances(kNumThreads, VectorXd(kNumTestPoints));
+  std::vector<std::thread> threads;
+  for (size_t tt = 0; tt < kNumThreads; tt++) {
+    threads.push_back(std::thread([&, tt]() {
+      for (size_t ii = 0; ii < kNumTestPoints; ii++)
+        gp.Evaluate(queries[ii], means[tt](ii), variances[tt](ii));
+    }));
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    double mean, variance;
+    reference.Evaluate(queries[ii], mean, variance);
+
+    for (size_t tt = 0; tt < kNumThreads; tt++) {
+      EXPECT_NEAR(means[tt](ii), mean, kMaxError);
+      EXPECT_NEAR(variances[tt](ii), variance, kMaxError);
+    }
+  }
+}
+
 } //\namespace test
 } //\namespace gp
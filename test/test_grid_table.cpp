@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for GridTable, and for baking a GP into one.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/grid_table.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that tables reproduce node values, and that linear interpolation of
+// an affine function is exact.
+TEST(GridTable, TestInterpolation) {
+  const size_t kDimension = 3;
+  const size_t kResolution = 5;
+  const size_t kNumTestPoints = 100;
+  const double kMaxError = 1e-10;
+
+  const VectorXd lower = -VectorXd::Ones(kDimension);
+  const VectorXd upper = 2.0 * VectorXd::Ones(kDimension);
+  const VectorXd slope = VectorXd::Random(kDimension);
+  const VectorXd spacing = (upper - lower) / (kResolution - 1.0);
+
+  // Nodes, with the first dimension varying fastest.
+  std::vector<VectorXd> nodes;
+  for (size_t kk = 0; kk < kResolution; kk++) {
+    for (size_t jj = 0; jj < kResolution; jj++) {
+      for (size_t ii = 0; ii < kResolution; ii++) {
+        VectorXd x(kDimension);
+        x << ii, jj, kk;
+        nodes.push_back(lower + spacing.cwiseProduct(x));
+      }
+    }
+  }
+
+  VectorXd means(nodes.size());
+  VectorXd variances(nodes.size());
+  for (size_t ii = 0; ii < nodes.size(); ii++) {
+    means(ii) = slope.dot(nodes[ii]) + 1.0;
+    variances(ii) = nodes[ii].squaredNorm();
+  }
+
+  const GridTable linear(lower, upper, kResolution, LINEAR,
+                         means, variances);
+  const GridTable cubic(lower, upper, kResolution, CUBIC,
+                        means, variances);
+  EXPECT_EQ(linear.NumNodes(), nodes.size());
+
+  for (size_t ii = 0; ii < nodes.size(); ii++) {
+    double mean, variance;
+    linear.Evaluate(nodes[ii], mean, variance);
+    EXPECT_NEAR(mean, means(ii), kMaxError);
+    EXPECT_NEAR(variance, variances(ii), kMaxError);
+
+    cubic.Evaluate(nodes[ii], mean, variance);
+    EXPECT_NEAR(mean, means(ii), kMaxError);
+    EXPECT_NEAR(variance, variances(ii), kMaxError);
+  }
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = lower + (upper - lower).cwiseProduct(
+      0.5 * (VectorXd::Random(kDimension) + VectorXd::Ones(kDimension)));
+
+    double mean, variance;
+    linear.Evaluate(x, mean, variance);
+    EXPECT_NEAR(mean, slope.dot(x) + 1.0, kMaxError);
+  }
+
+  // Points outside the box are clamped to it.
+  double mean, variance;
+  linear.Evaluate(upper + VectorXd::Ones(kDimension), mean, variance);
+  EXPECT_NEAR(mean, slope.dot(upper) + 1.0, kMaxError);
+}
+
+// Check that the batch Evaluate agrees with the pointwise one, and that a
+// baked table tracks the exact GP to within the reported error.
+TEST(GaussianProcess, TestBakeGrid) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 200;
+  const size_t kResolution = 60;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxBatchError = 1e-10;
+  const double kMaxLinearError = 5e-3;
+  const double kMaxCubicError = 1e-4;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(2.0 * points->back().sum());
+  }
+
+  const GaussianProcess gp(RbfKernel::Create(VectorXd::Constant(kDimension, 0.5)),
+                           kNoiseVariance, points, targets, kNumTrainingPoints);
+
+  std::vector<VectorXd> queries;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    queries.push_back(VectorXd::Random(kDimension));
+
+  VectorXd means, variances;
+  gp.Evaluate(queries, means, variances);
+  ASSERT_EQ(means.size(), kNumTestPoints);
+  ASSERT_EQ(variances.size(), kNumTestPoints);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    double mean, variance;
+    gp.Evaluate(queries[ii], mean, variance);
+    EXPECT_NEAR(means(ii), mean, kMaxBatchError);
+    EXPECT_NEAR(variances(ii), variance, kMaxBatchError);
+  }
+
+  const VectorXd lower = -VectorXd::Ones(kDimension);
+  const VectorXd upper = VectorXd::Ones(kDimension);
+  for (const InterpolationType interpolation : { LINEAR, CUBIC }) {
+    const double max_error =
+      (interpolation == LINEAR) ? kMaxLinearError : kMaxCubicError;
+
+    GridOptions options;
+    options.interpolation = interpolation;
+    GridSummary summary;
+    const GridTable::ConstPtr table =
+      gp.BakeGrid(lower, upper, kResolution, options, &summary);
+
+    EXPECT_EQ(summary.num_nodes, kResolution * kResolution);
+    EXPECT_LT(summary.max_mean_error, max_error);
+    EXPECT_LT(summary.max_variance_error, max_error);
+    EXPECT_LE(summary.rms_mean_error, summary.max_mean_error);
+
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      double mean, variance;
+      table->Evaluate(queries[ii], mean, variance);
+      EXPECT_NEAR(mean, means(ii), max_error);
+      EXPECT_NEAR(variance, variances(ii), max_error);
+    }
+  }
+}
+
+} //\namespace test
+} //\namespace gp
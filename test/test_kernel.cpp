@@ -34,7 +34,11 @@
  * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
  */
 
+#include <kernels/expression_kernel.hpp>
+#include <kernels/matern_kernel.hpp>
+#include <kernels/periodic_kernel.hpp>
 #include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
 #include <utils/types.hpp>
 
 #include <glog/logging.h>
@@ -88,6 +92,324 @@ TEST(RbfKernel, TestPartials) {
   }
 }
 
+// Make sure that the kernel second partial derivatives are correct, and that
+// they agree with the finite difference default in the base class.
+TEST(RbfKernel, TestSecondPartials) {
+  const double kMaxError = 1e-6;
+  const double kEpsilon = 1e-6;
+  const size_t kDimension = 5;
+  const size_t kNumTests = 10;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.5, 1.5);
+
+  // Create a kernel.
+  VectorXd lengths(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    lengths(ii) = unif(rng);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+
+  for (size_t kk = 0; kk < kNumTests; kk++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    const VectorXd y = VectorXd::Random(kDimension);
+
+    MatrixXd hessian;
+    kernel->Hessian(x, y, hessian);
+    ASSERT_EQ(hessian.rows(), kDimension);
+    ASSERT_EQ(hessian.cols(), kDimension);
+
+    for (size_t ii = 0; ii < kDimension; ii++) {
+      for (size_t jj = 0; jj < kDimension; jj++) {
+        // Compute analytic second derivative.
+        const double analytic = kernel->SecondPartial(x, y, ii, jj);
+        EXPECT_NEAR(analytic, hessian(ii, jj), kMaxError);
+        EXPECT_NEAR(analytic, kernel->Kernel::SecondPartial(x, y, ii, jj),
+                    kMaxError);
+
+        // Compute numerical derivative.
+        kernel->Adjust(kEpsilon, jj);
+        const double forward = kernel->Partial(x, y, ii);
+
+        kernel->Adjust(-2.0 * kEpsilon, jj);
+        const double backward = kernel->Partial(x, y, ii);
+
+        kernel->Adjust(kEpsilon, jj);
+        EXPECT_NEAR(analytic, (forward - backward) / (2.0 * kEpsilon),
+                    kMaxError);
+      }
+    }
+  }
+}
+
+// Make sure that an RBF expression agrees with RbfKernel.
+TEST(ExpressionKernel, TestMatchesRbfKernel) {
+  const double kMaxError = 1e-12;
+  const size_t kDimension = 5;
+  const size_t kNumTests = 10;
+
+  const VectorXd lengths = VectorXd::Random(kDimension).cwiseAbs() +
+    VectorXd::Constant(kDimension, 0.1);
+  const Kernel::Ptr expected = RbfKernel::Create(lengths);
+  const Kernel::Ptr kernel = MakeKernel(Rbf(lengths));
+  EXPECT_EQ(kernel->ImmutableParams(), lengths);
+
+  for (size_t ii = 0; ii < kNumTests; ii++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    const VectorXd y = VectorXd::Random(kDimension);
+    EXPECT_NEAR(kernel->Evaluate(x, y), expected->Evaluate(x, y), kMaxError);
+
+    VectorXd gradient, expected_gradient;
+    kernel->Gradient(x, y, gradient);
+    expected->Gradient(x, y, expected_gradient);
+    EXPECT_LE((gradient - expected_gradient).cwiseAbs().maxCoeff(), kMaxError);
+  }
+}
+
+// Make sure that partial derivatives of composite expressions are correct.
+TEST(ExpressionKernel, TestPartials) {
+  const double kMaxError = 1e-7;
+  const double kEpsilon = 1e-6;
+  const size_t kDimension = 3;
+  const size_t kNumTests = 10;
+
+  const VectorXd short_lengths = VectorXd::Constant(kDimension, 0.3);
+  const VectorXd long_lengths = VectorXd::Constant(kDimension, 2.0);
+  const Kernel::Ptr kernel = MakeKernel(
+    Scale(1.5, Rbf(long_lengths)) +
+    Rbf(short_lengths) * Scale(0.5, Rbf(long_lengths)));
+
+  const size_t num_params = kernel->ImmutableParams().size();
+  ASSERT_EQ(num_params, 2 + 3 * kDimension);
+  EXPECT_EQ(kernel->ImmutableParams()(0), 1.5);
+  EXPECT_EQ(kernel->ImmutableParams()(1 + 2 * kDimension), 0.5);
+
+  for (size_t jj = 0; jj < kNumTests; jj++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    const VectorXd y = VectorXd::Random(kDimension);
+
+    // Diagonal is the sum of the scales.
+    EXPECT_NEAR(kernel->Evaluate(x, x), 2.0, kMaxError);
+
+    VectorXd gradient;
+    kernel->Gradient(x, y, gradient);
+    ASSERT_EQ(gradient.size(), num_params);
+
+    for (size_t ii = 0; ii < num_params; ii++) {
+      const double analytic = kernel->Partial(x, y, ii);
+      EXPECT_EQ(analytic, gradient(ii));
+
+      // Compute numerical derivative on a clone.
+      const Kernel::Ptr shifted = kernel->Clone();
+      shifted->Adjust(kEpsilon, ii);
+      const double forward = shifted->Evaluate(x, y);
+
+      shifted->Adjust(-2.0 * kEpsilon, ii);
+      const double backward = shifted->Evaluate(x, y);
+
+      EXPECT_NEAR(analytic, (forward - backward) / (2.0 * kEpsilon),
+                  kMaxError);
+    }
+  }
+}
+
+// Make sure that partial derivatives of the Matern and periodic leaves are
+// correct, alone and composed.
+TEST(ExpressionKernel, TestMaternAndPeriodicPartials) {
+  const double kMaxError = 1e-7;
+  const double kEpsilon = 1e-6;
+  const size_t kDimension = 3;
+  const size_t kNumTests = 10;
+
+  const Kernel::Ptr kernel = MakeKernel(
+    Scale(1.2, Matern(0.7)) +
+    Rbf(VectorXd::Constant(kDimension, 0.9)) * Periodic(0.8, 1.3));
+
+  const size_t num_params = kernel->ImmutableParams().size();
+  ASSERT_EQ(num_params, 4 + kDimension);
+
+  for (size_t jj = 0; jj < kNumTests; jj++) {
+    const VectorXd x = VectorXd::Random(kDimension);
+    const VectorXd y = VectorXd::Random(kDimension);
+    EXPECT_NEAR(kernel->Evaluate(x, x), 2.2, kMaxError);
+
+    VectorXd gradient;
+    kernel->Gradient(x, y, gradient);
+    ASSERT_EQ(gradient.size(), num_params);
+
+    for (size_t ii = 0; ii < num_params; ii++) {
+      const double analytic = kernel->Partial(x, y, ii);
+      EXPECT_EQ(analytic, gradient(ii));
+
+      // Compute numerical derivative on a clone.
+      const Kernel::Ptr shifted = kernel->Clone();
+      shifted->Adjust(kEpsilon, ii);
+      const double forward = shifted->Evaluate(x, y);
+
+      shifted->Adjust(-2.0 * kEpsilon, ii);
+      const double backward = shifted->Evaluate(x, y);
+
+      EXPECT_NEAR(analytic, (forward - backward) / (2.0 * kEpsilon),
+                  kMaxError);
+    }
+  }
+}
+
+// Make sure that covariance gradients assembled from one gradient per pair
+// agree with the default, which calls Partial once per parameter and pair.
+TEST(ExpressionKernel, TestCovarianceGradients) {
+  const double kMaxError = 1e-12;
+  const size_t kDimension = 2;
+  const size_t kNumPoints = 15;
+
+  const Kernel::Ptr kernel = MakeKernel(
+    Scale(0.5, Rbf(VectorXd::Constant(kDimension, 0.4))) + Matern(1.1));
+
+  std::vector<VectorXd> points;
+  for (size_t ii = 0; ii < kNumPoints; ii++)
+    points.push_back(VectorXd::Random(kDimension));
+
+  std::vector<MatrixXd> gradients, expected;
+  kernel->CovarianceGradients(points, gradients);
+  kernel->Kernel::CovarianceGradients(points, expected);
+
+  ASSERT_EQ(gradients.size(), kernel->ImmutableParams().size());
+  ASSERT_EQ(expected.size(), gradients.size());
+  for (size_t ii = 0; ii < gradients.size(); ii++) {
+    EXPECT_LE((gradients[ii] - expected[ii]).cwiseAbs().maxCoeff(),
+              kMaxError);
+  }
+}
+
+// Scaling the kernel and the noise by the same factor leaves the mean
+// unchanged and scales the variance, which checks that the GP takes the prior
+// variance from the kernel rather than assuming it is one.
+TEST(ExpressionKernel, TestScaledProcess) {
+  const double kMaxError = 1e-8;
+  const double kScale = 4.0;
+  const double kNoiseVariance = 1e-2;
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 20;
+  const size_t kNumTestPoints = 10;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = points->back().sum();
+  }
+
+  const VectorXd lengths = VectorXd::Constant(kDimension, 0.5);
+  GaussianProcess unscaled(RbfKernel::Create(lengths), kNoiseVariance,
+                           points, targets, kNumTrainingPoints + 1);
+  const PointSet scaled_points(new std::vector<VectorXd>(*points));
+  GaussianProcess scaled(MakeKernel(Scale(kScale, Rbf(lengths))),
+                         kScale * kNoiseVariance, scaled_points, targets,
+                         kNumTrainingPoints + 1);
+
+  // Adding a point exercises the incremental diagonal too.
+  const VectorXd x = VectorXd::Random(kDimension);
+  EXPECT_TRUE(unscaled.Add(x, 1.0));
+  EXPECT_TRUE(scaled.Add(x, 1.0));
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd query = 2.0 * VectorXd::Random(kDimension);
+
+    double mean, variance, expected_mean, expected_variance;
+    scaled.Evaluate(query, mean, variance);
+    unscaled.Evaluate(query, expected_mean, expected_variance);
+
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, kScale * expected_variance, kMaxError);
+  }
+
+  double mean, variance, expected_mean, expected_variance;
+  scaled.EvaluateTrainingPoint(0, mean, variance);
+  unscaled.EvaluateTrainingPoint(0, expected_mean, expected_variance);
+  EXPECT_NEAR(mean, expected_mean, kMaxError);
+  EXPECT_NEAR(variance, kScale * expected_variance, kMaxError);
+}
+
+#ifdef GP_USE_CERES
+// Make sure that autodiff partial derivatives match finite differences, and
+// that Gradient agrees with Partial.
+TEST(AutoDiffKernel, TestPartials) {
+  const double kMaxError = 1e-8;
+  const double kEpsilon = 1e-6;
+  const size_t kDimension = 3;
+  const size_t kNumTests = 10;
+
+  std::vector<Kernel::Ptr> kernels;
+  kernels.push_back(MaternKernel::Create(0.7));
+  kernels.push_back(PeriodicKernel::Create(0.8, 1.3));
+
+  for (const Kernel::Ptr& kernel : kernels) {
+    const size_t num_params = kernel->ImmutableParams().size();
+
+    // Clones must evaluate identically.
+    const Kernel::Ptr clone = kernel->Clone();
+
+    for (size_t jj = 0; jj < kNumTests; jj++) {
+      const VectorXd x = VectorXd::Random(kDimension);
+      const VectorXd y = VectorXd::Random(kDimension);
+      EXPECT_NEAR(kernel->Evaluate(x, y), clone->Evaluate(x, y), kMaxError);
+      EXPECT_NEAR(kernel->Evaluate(x, x), 1.0, kMaxError);
+
+      VectorXd gradient;
+      kernel->Gradient(x, y, gradient);
+      ASSERT_EQ(gradient.size(), num_params);
+
+      for (size_t ii = 0; ii < num_params; ii++) {
+        const double autodiff = kernel->Partial(x, y, ii);
+        EXPECT_NEAR(autodiff, gradient(ii), kMaxError);
+
+        // Compute numerical derivative.
+        kernel->Adjust(kEpsilon, ii);
+        const double forward = kernel->Evaluate(x, y);
+
+        kernel->Adjust(-2.0 * kEpsilon, ii);
+        const double backward = kernel->Evaluate(x, y);
+
+        kernel->Adjust(kEpsilon, ii);
+        EXPECT_NEAR(autodiff, (forward - backward) / (2.0 * kEpsilon),
+                    kMaxError);
+      }
+    }
+  }
+}
+
+// Make sure that the analytic Matern and periodic expressions agree with the
+// autodiff kernels.
+TEST(ExpressionKernel, TestMatchesAutoDiffKernels) {
+  const double kMaxError = 1e-10;
+  const size_t kDimension = 3;
+  const size_t kNumTests = 10;
+
+  std::vector< std::pair<Kernel::Ptr, Kernel::Ptr> > kernels;
+  kernels.push_back(std::make_pair(MakeKernel(Matern(0.7)),
+                                   MaternKernel::Create(0.7)));
+  kernels.push_back(std::make_pair(MakeKernel(Periodic(0.8, 1.3)),
+                                   PeriodicKernel::Create(0.8, 1.3)));
+
+  for (const auto& pair : kernels) {
+    for (size_t jj = 0; jj < kNumTests; jj++) {
+      const VectorXd x = VectorXd::Random(kDimension);
+      const VectorXd y = VectorXd::Random(kDimension);
+      EXPECT_NEAR(pair.first->Evaluate(x, y), pair.second->Evaluate(x, y),
+                  kMaxError);
+
+      VectorXd gradient, expected_gradient;
+      pair.first->Gradient(x, y, gradient);
+      pair.second->Gradient(x, y, expected_gradient);
+      EXPECT_LE((gradient - expected_gradient).cwiseAbs().maxCoeff(),
+                kMaxError);
+    }
+  }
+}
+#endif
+
 } //\namespace test
 
 } //\namespace gp
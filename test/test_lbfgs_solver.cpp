@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for the built-in L-BFGS solver.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <optimization/lbfgs_solver.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  // Extended Rosenbrock function, minimized at (1, 1, ..., 1).
+  class Rosenbrock : public FirstOrderFunction {
+  public:
+    explicit Rosenbrock(size_t n) : n_(n) {}
+
+    bool Evaluate(const double* const x, double* cost,
+                  double* gradient) const {
+      *cost = 0.0;
+      if (gradient) {
+        for (size_t ii = 0; ii < n_; ii++)
+          gradient[ii] = 0.0;
+      }
+
+      for (size_t ii = 0; ii + 1 < n_; ii++) {
+        const double a = x[ii + 1] - x[ii] * x[ii];
+        const double b = 1.0 - x[ii];
+        *cost += 100.0 * a * a + b * b;
+
+        if (gradient) {
+          gradient[ii] += -400.0 * a * x[ii] - 2.0 * b;
+          gradient[ii + 1] += 200.0 * a;
+        }
+      }
+
+      return true;
+    }
+
+    int NumParameters() const { return static_cast<int>(n_); }
+
+  private:
+    const size_t n_;
+  }; //\class Rosenbrock
+
+  // Callback returning a fixed status after a given number of iterations.
+  class StopAfter : public IterationCallback {
+  public:
+    StopAfter(size_t iterations, CallbackReturnType status)
+      : iterations_(iterations), status_(status) {}
+
+    CallbackReturnType operator()(size_t iteration, double cost,
+                                  const VectorXd& parameters) {
+      return (iteration >= iterations_) ? status_ : CONTINUE;
+    }
+
+  private:
+    const size_t iterations_;
+    const CallbackReturnType status_;
+  }; //\class StopAfter
+} //\namespace
+
+// Check that the solver finds the minimum of the Rosenbrock function.
+TEST(LbfgsSolver, TestRosenbrock) {
+  const size_t kNumParameters = 10;
+  const Rosenbrock function(kNumParameters);
+
+  LbfgsOptions options;
+  options.function_tolerance = 1e-14;
+
+  LbfgsSolver solver(kNumParameters, options.rank);
+  VectorXd parameters = VectorXd::Constant(kNumParameters, -1.2);
+
+  LbfgsSolver::Summary summary;
+  EXPECT_TRUE(solver.Solve(function, options, 1000,
+                           std::vector<IterationCallback*>(),
+                           parameters, &summary));
+  EXPECT_TRUE(summary.usable);
+  EXPECT_LT(summary.final_cost, summary.initial_cost);
+  EXPECT_GT(solver.NumPairs(), 0u);
+  EXPECT_LE(solver.NumPairs(), solver.Rank());
+
+  for (size_t ii = 0; ii < kNumParameters; ii++)
+    EXPECT_NEAR(parameters(ii), 1.0, 1e-3);
+}
+
+// Check that warm starting keeps curvature pairs and that re-solving from
+// the minimum stops immediately.
+TEST(LbfgsSolver, TestWarmStart) {
+  const size_t kNumParameters = 4;
+  const Rosenbrock function(kNumParameters);
+
+  LbfgsOptions options;
+  options.function_tolerance = 1e-14;
+
+  LbfgsSolver solver(kNumParameters, options.rank);
+  VectorXd parameters = VectorXd::Constant(kNumParameters, -1.2);
+  LbfgsSolver::Summary summary;
+  solver.Solve(function, options, 1000, std::vector<IterationCallback*>(),
+               parameters, &summary);
+
+  const size_t num_pairs = solver.NumPairs();
+  ASSERT_GT(num_pairs, 0);
+
+  // Perturb slightly and re-solve with and without a warm start.
+  const VectorXd perturbed =
+    parameters + VectorXd::Constant(kNumParameters, 1e-2);
+
+  options.warm_start = true;
+  VectorXd warm = perturbed;
+  LbfgsSolver::Summary warm_summary;
+  solver.Solve(function, options, 1000, std::vector<IterationCallback*>(),
+               warm, &warm_summary);
+
+  options.warm_start = false;
+  VectorXd cold = perturbed;
+  LbfgsSolver::Summary cold_summary;
+  solver.Solve(function, options, 1000, std::vector<IterationCallback*>(),
+               cold, &cold_summary);
+
+  EXPECT_TRUE(warm_summary.usable);
+  EXPECT_TRUE(cold_summary.usable);
+  EXPECT_LE(warm_summary.num_iterations, cold_summary.num_iterations);
+  EXPECT_NEAR(warm_summary.final_cost, 0.0, 1e-8);
+
+  // Reset forgets everything.
+  solver.Reset();
+  EXPECT_EQ(solver.NumPairs(), 0u);
+}
+
+// Check that callbacks can stop the solver early.
+TEST(LbfgsSolver, TestCallbacks) {
+  const size_t kNumParameters = 10;
+  const size_t kStopIteration = 3;
+  const Rosenbrock function(kNumParameters);
+  const LbfgsOptions options;
+
+  LbfgsSolver solver(kNumParameters, options.rank);
+
+  // Terminate: result is usable but not converged.
+  StopAfter terminate(kStopIteration, TERMINATE);
+  std::vector<IterationCallback*> callbacks(1, &terminate);
+
+  VectorXd parameters = VectorXd::Constant(kNumParameters, -1.2);
+  LbfgsSolver::Summary summary;
+  EXPECT_TRUE(solver.Solve(function, options, 1000, callbacks,
+                           parameters, &summary));
+  EXPECT_TRUE(summary.usable);
+  EXPECT_FALSE(summary.converged);
+  EXPECT_EQ(summary.num_iterations, kStopIteration);
+
+  // Abort: result is not usable.
+  StopAfter abort(kStopIteration, ABORT);
+  callbacks[0] = &abort;
+
+  parameters = VectorXd::Constant(kNumParameters, -1.2);
+  EXPECT_FALSE(solver.Solve(function, options, 1000, callbacks,
+                            parameters, &summary));
+  EXPECT_FALSE(summary.usable);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -43,6 +43,7 @@
 #include "test_functions.hpp"
 #include "test_plotting.hpp"
 
+#include <Eigen/Eigenvalues>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <gflags/gflags.h>
@@ -124,6 +125,118 @@ TEST(TrainingLogLikelihood, TestGradient) {
   }
 }
 
+// Check that TrainingLogLikelihood reuses its factorization when evaluated
+// repeatedly at the same parameters, and that results are unaffected.
+TEST(TrainingLogLikelihood, TestCachedFactorization) {
+  const size_t kDimension = 5;
+  const size_t kNumTrainingPoints = 20;
+  const double kNoiseVariance = 0.1;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  // Create two identical costs.
+  const VectorXd lengths = VectorXd::Constant(kDimension, 1.0);
+  TrainingLogLikelihood cached(
+    points, &targets, RbfKernel::Create(lengths), kNoiseVariance);
+  TrainingLogLikelihood fresh(
+    points, &targets, RbfKernel::Create(lengths), kNoiseVariance);
+
+  double parameters[kDimension];
+  for (size_t ii = 0; ii < kDimension; ii++)
+    parameters[ii] = 1.0 + unif(rng);
+
+  EXPECT_TRUE(cached.CachedProcess(parameters) == NULL);
+
+  // Cost only, then cost and gradient at the same parameters.
+  double cost, gradient[kDimension];
+  EXPECT_TRUE(cached.Evaluate(parameters, &cost, NULL));
+  const GaussianProcess* gp = cached.CachedProcess(parameters);
+  EXPECT_TRUE(gp != NULL);
+
+  EXPECT_TRUE(cached.Evaluate(parameters, &cost, gradient));
+  EXPECT_EQ(gp, cached.CachedProcess(parameters));
+
+  double expected_cost, expected_gradient[kDimension];
+  EXPECT_TRUE(fresh.Evaluate(parameters, &expected_cost, expected_gradient));
+  EXPECT_EQ(cost, expected_cost);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    EXPECT_EQ(gradient[ii], expected_gradient[ii]);
+
+  // Moving the parameters must invalidate the cache.
+  parameters[0] += 0.1;
+  EXPECT_TRUE(cached.CachedProcess(parameters) == NULL);
+}
+
+// Check that the gradient computation in MinibatchLogLikelihood is correct.
+TEST(MinibatchLogLikelihood, TestGradient) {
+  const size_t kDimension = 5;
+  const size_t kNumTrainingPoints = 20;
+  const size_t kBatchSize = 10;
+  const size_t kNumTests = 10;
+  const double kEpsilon = 1e-6;
+  const double kMaxError = 1e-4;
+  const double kNoiseVariance = 0.1;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = unif(rng);
+  }
+
+  // Use every other point as the minibatch.
+  std::vector<size_t> batch;
+  for (size_t ii = 0; ii < kBatchSize; ii++)
+    batch.push_back(2 * ii);
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 1.0));
+  MinibatchLogLikelihood cost(points, &targets, kernel, kNoiseVariance);
+
+  VectorXd gradient;
+  for (size_t ii = 0; ii < kNumTests; ii++) {
+    // Pick a random set of length vectors.
+    for (size_t jj = 0; jj < kDimension; jj++)
+      kernel->Params()(jj) = 1.0 + unif(rng);
+
+    double objective;
+    EXPECT_TRUE(cost.Evaluate(batch, &objective, gradient));
+
+    // Evaluate numerical gradient with a central difference.
+    VectorXd unused;
+    for (size_t jj = 0; jj < kDimension; jj++) {
+      double forward, backward;
+      kernel->Adjust(kEpsilon, jj);
+      EXPECT_TRUE(cost.Evaluate(batch, &forward, unused));
+      kernel->Adjust(-2.0 * kEpsilon, jj);
+      EXPECT_TRUE(cost.Evaluate(batch, &backward, unused));
+      kernel->Adjust(kEpsilon, jj);
+
+      EXPECT_NEAR(gradient(jj), (forward - backward) / (2.0 * kEpsilon),
+                  kMaxError);
+    }
+  }
+}
+
 // Sample points from a simple function and fit a GP model. Make sure that
 // after learning hyperparameters for an RBF kernel, the GP improves its
 // root mean squared error against a random set of points.
@@ -194,5 +307,526 @@ TEST(GaussianProcess, TestLearnHyperparams) {
   }
 }
 
+// Same as above, but learn hyperparameters from several random starts in
+// parallel with early cancellation of losing starts.
+TEST(GaussianProcess, TestMultiStartLearnHyperparams) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 100;
+  const double kMaxRmsError = 0.01;
+  const double kNoiseVariance = 1e-4;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    const double x = unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  // Train a GP.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 1.0));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  MultiStartOptions options;
+  options.num_starts = 8;
+  options.num_threads = 4;
+  options.cancel_margin = 100.0;
+  EXPECT_TRUE(gp.LearnHyperparams(options));
+
+  // Test that we have approximated the function well.
+  double squared_error = 0.0;
+  double mean, variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const double x = unif(rng);
+
+    gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+  }
+
+  EXPECT_LE(std::sqrt(squared_error / static_cast<double>(kNumTestPoints)),
+            kMaxRmsError);
+}
+
+// Learn hyperparameters from minibatches with Adam and Hutchinson trace
+// estimates, and make sure the result still fits the function well.
+TEST(GaussianProcess, TestStochasticLearnHyperparams) {
+  const size_t kNumTrainingPoints = 400;
+  const size_t kNumTestPoints = 100;
+  const double kMaxRmsError = 0.01;
+  const double kNoiseVariance = 1e-4;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    const double x = unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  // Train a GP.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 1.0));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  StochasticOptions options;
+  options.batch_size = 50;
+  options.num_iterations = 300;
+  options.num_probes = 16;
+  EXPECT_TRUE(gp.LearnHyperparams(options));
+
+  // Test that we have approximated the function well.
+  double squared_error = 0.0;
+  double mean, variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const double x = unif(rng);
+
+    gp.Evaluate(VectorXd::Constant(1, x), mean, variance);
+    squared_error += (mean - BumpyParabola(x)) * (mean - BumpyParabola(x));
+  }
+
+  EXPECT_LE(std::sqrt(squared_error / static_cast<double>(kNumTestPoints)),
+            kMaxRmsError);
+}
+
+// Learn hyperparameters in the background while adding points, and make sure
+// that the installed model matches one built from scratch with the learned
+// hyperparameters on all the points.
+TEST(GaussianProcess, TestLearnHyperparamsAsync) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumAddedPoints = 20;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    const double x = unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  // Train a GP with room for more points.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints + kNumAddedPoints);
+
+  // Learn synchronously on the same snapshot, with the same default
+  // settings, for the parameters background learning should arrive at.
+  const Kernel::Ptr reference_kernel = kernel->Clone();
+  GaussianProcess reference(reference_kernel, kNoiseVariance,
+                            PointSet(new std::vector<VectorXd>(*points)),
+                            targets, kNumTrainingPoints);
+  EXPECT_TRUE(reference.LearnHyperparams());
+
+  std::future<bool> learned = gp.LearnHyperparamsAsync();
+
+  // Keep adding points while learning is in progress.
+  for (size_t ii = 0; ii < kNumAddedPoints; ii++) {
+    const double x = unif(rng);
+    EXPECT_TRUE(gp.Add(VectorXd::Constant(1, x), BumpyParabola(x)));
+  }
+
+  EXPECT_TRUE(learned.get());
+
+  // Learning may have finished in time for one of the calls to Add to install
+  // the result already. Either way the learned parameters are in place after
+  // this, and there is nothing left to install.
+  gp.InstallHyperparams();
+  EXPECT_FALSE(gp.InstallHyperparams());
+  const VectorXd& expected_params = reference_kernel->ImmutableParams();
+  EXPECT_LE((kernel->ImmutableParams() - expected_params).cwiseAbs().maxCoeff(),
+            kMaxError * expected_params.cwiseAbs().maxCoeff());
+
+  // Build a GP from scratch with the learned kernel on all points.
+  const size_t N = gp.ImmutablePoints()->size();
+  EXPECT_EQ(N, kNumTrainingPoints + kNumAddedPoints);
+
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, points,
+                           gp.ImmutableTargets().head(N), N);
+  EXPECT_LE((expected.ImmutableRegressedTargets() -
+             gp.ImmutableRegressedTargets().head(N)).cwiseAbs().maxCoeff(),
+            kMaxError * expected.ImmutableRegressedTargets().cwiseAbs().maxCoeff());
+}
+
+// Change the noise variance while learning in the background, and make sure
+// that the stale background result is never installed.
+TEST(GaussianProcess, TestLearnHyperparamsAsyncCancelled) {
+  const size_t kNumTrainingPoints = 100;
+  const double kNoiseVariance = 1e-3;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    const double x = unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.1));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints + 1);
+
+  // Supersede one background optimization with another, then change the
+  // noise variance before either result can be installed.
+  std::future<bool> superseded = gp.LearnHyperparamsAsync();
+  std::future<bool> learned = gp.LearnHyperparamsAsync();
+  const VectorXd params = kernel->ImmutableParams();
+  EXPECT_TRUE(gp.SetNoise(2.0 * kNoiseVariance));
+
+  superseded.wait();
+  learned.wait();
+
+  // Nothing learned in the background may replace the current kernel.
+  EXPECT_FALSE(gp.InstallHyperparams());
+  EXPECT_TRUE(gp.Add(VectorXd::Constant(1, 0.5), BumpyParabola(0.5)));
+  EXPECT_EQ(kernel->ImmutableParams(), params);
+  EXPECT_EQ(gp.Noise(), 2.0 * kNoiseVariance);
+}
+
+// Learn hyperparameters under a tight wall-clock budget, and make sure that
+// learning stops early but still leaves a consistent, improved model.
+TEST(GaussianProcess, TestLearnHyperparamsDeadline) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 300;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxSeconds = 1e-3;
+  const double kMaxOverrunSeconds = 1.0;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = BumpyParabola(points->back().norm());
+  }
+
+  // Train a GP.
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 1.0));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  LearningOptions options;
+  options.max_seconds = kMaxSeconds;
+
+  LearningSummary summary;
+  const bool success = gp.LearnHyperparams(options, &summary);
+  EXPECT_EQ(success, summary.success);
+  EXPECT_TRUE(summary.deadline_reached);
+  EXPECT_LT(summary.num_iterations, options.max_iterations);
+  EXPECT_LE(summary.seconds, kMaxSeconds + kMaxOverrunSeconds);
+  EXPECT_GE(summary.LogLikelihoodImprovement(), 0.0);
+
+  // Whatever happened, the GP must be consistent with its kernel.
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  EXPECT_LE((expected.ImmutableRegressedTargets() -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected.ImmutableRegressedTargets().cwiseAbs().maxCoeff());
+}
+
+// Check that online learning finds the length scale the data was drawn with,
+// improving the likelihood of recent points, and that the GP stays consistent
+// with whatever parameters it installed.
+TEST(GaussianProcess, TestOnlineLearning) {
+  const size_t kNumTrainingPoints = 300;
+  const size_t kNumSeedPoints = 20;
+  const size_t kBatchSize = 10;
+  const double kNoiseVariance = 1e-3;
+  const double kTrueLength = 0.1;
+  const double kInitialLength = 1.0;
+  const double kMaxLengthRatio = 3.0;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  // Draw training targets from a GP prior with a known length scale.
+  const Kernel::Ptr truth =
+    RbfKernel::Create(VectorXd::Constant(1, kTrueLength));
+  PointSet points(new std::vector<VectorXd>);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+
+  MatrixXd covariance(kNumTrainingPoints, kNumTrainingPoints);
+  VectorXd samples(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    for (size_t jj = 0; jj < kNumTrainingPoints; jj++)
+      covariance(ii, jj) = truth->Evaluate(points->at(ii), points->at(jj));
+
+    covariance(ii, ii) += kNoiseVariance;
+    samples(ii) = normal(rng);
+  }
+
+  const VectorXd targets = covariance.llt().matrixL() * samples;
+
+  // Start from a poor length scale and a few points, then stream in the rest
+  // one at a time and then in small batches.
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+  PointSet seed(new std::vector<VectorXd>(points->begin(),
+                                          points->begin() + kNumSeedPoints));
+  GaussianProcess gp(kernel, kNoiseVariance, seed,
+                     targets.head(kNumSeedPoints), kNumTrainingPoints);
+
+  OnlineOptions options;
+  options.step.learning_rate = 0.05;
+  gp.EnableOnlineLearning(options);
+
+  const size_t kNumSingles = kNumTrainingPoints / 2;
+  for (size_t ii = kNumSeedPoints; ii < kNumSingles; ii++)
+    EXPECT_TRUE(gp.Add(points->at(ii), targets(ii)));
+
+  for (size_t ii = kNumSingles; ii < kNumTrainingPoints; ii += kBatchSize) {
+    const std::vector<VectorXd> batch(points->begin() + ii,
+                                      points->begin() + ii + kBatchSize);
+    EXPECT_TRUE(gp.Add(batch, targets.segment(ii, kBatchSize)));
+  }
+
+  EXPECT_LT(kernel->ImmutableParams()(0), kMaxLengthRatio * kTrueLength);
+  EXPECT_GT(kernel->ImmutableParams()(0), kTrueLength / kMaxLengthRatio);
+
+  // Likelihood of the most recent window should have improved.
+  std::vector<size_t> window(options.window_size);
+  for (size_t ii = 0; ii < window.size(); ii++)
+    window[ii] = kNumTrainingPoints - window.size() + ii;
+
+  const Kernel::Ptr initial =
+    RbfKernel::Create(VectorXd::Constant(1, kInitialLength));
+  double initial_cost, learned_cost;
+  VectorXd gradient;
+  ASSERT_TRUE(MinibatchLogLikelihood(points, &targets, initial, kNoiseVariance)
+              .Evaluate(window, &initial_cost, gradient));
+  ASSERT_TRUE(MinibatchLogLikelihood(points, &targets, kernel, kNoiseVariance)
+              .Evaluate(window, &learned_cost, gradient));
+  EXPECT_LT(learned_cost, initial_cost);
+
+  // GP must be consistent with its kernel.
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  EXPECT_LE((expected.ImmutableRegressedTargets() -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected.ImmutableRegressedTargets().cwiseAbs().maxCoeff());
+}
+
+// Check the Hessian of TrainingLogLikelihood against central differences of
+// its gradient, and that the Fisher information is symmetric and positive
+// definite.
+TEST(TrainingLogLikelihood, TestHessian) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 30;
+  const double kNoiseVariance = 1e-2;
+  const double kEpsilon = 1e-6;
+  const double kMaxError = 1e-4;
+
+  // Get training points/targets.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = BumpyParabola(points->back().norm());
+  }
+
+  const VectorXd params = (VectorXd(kDimension) << 0.5, 0.8).finished();
+  const Kernel::Ptr kernel = RbfKernel::Create(params);
+  const TrainingLogLikelihood cost(points, &targets, kernel, kNoiseVariance);
+
+  MatrixXd hessian;
+  cost.Hessian(params.data(), hessian);
+  ASSERT_EQ(hessian.rows(), kDimension);
+  ASSERT_EQ(hessian.cols(), kDimension);
+
+  double unused;
+  VectorXd forward(kDimension), backward(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++) {
+    VectorXd shifted = params;
+    shifted(ii) += kEpsilon;
+    cost.Evaluate(shifted.data(), &unused, forward.data());
+
+    shifted(ii) -= 2.0 * kEpsilon;
+    cost.Evaluate(shifted.data(), &unused, backward.data());
+
+    const VectorXd numerical = (forward - backward) / (2.0 * kEpsilon);
+    for (size_t jj = 0; jj < kDimension; jj++)
+      EXPECT_NEAR(hessian(jj, ii), numerical(jj),
+                  kMaxError * std::max(1.0, std::abs(numerical(jj))));
+  }
+
+  MatrixXd fisher;
+  cost.Hessian(params.data(), fisher, true);
+  EXPECT_LE((fisher - fisher.transpose()).cwiseAbs().maxCoeff(), 1e-12);
+  EXPECT_GT(Eigen::SelfAdjointEigenSolver<MatrixXd>(fisher)
+            .eigenvalues().minCoeff(), 0.0);
+}
+
+// Check that the trust region Newton method converges to a stationary point
+// of the log-likelihood of an ARD kernel, and installs it consistently.
+TEST(GaussianProcess, TestNewtonLearnHyperparams) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 100;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxGradient = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  // Draw training targets from a GP prior whose length scales differ by
+  // dimension, so that the likelihood has a finite maximizer.
+  const Kernel::Ptr truth =
+    RbfKernel::Create((VectorXd(kDimension) << 0.3, 0.6, 1.2).finished());
+  PointSet points(new std::vector<VectorXd>);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    points->push_back(VectorXd::Random(kDimension));
+
+  MatrixXd covariance(kNumTrainingPoints, kNumTrainingPoints);
+  VectorXd samples(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    for (size_t jj = 0; jj < kNumTrainingPoints; jj++)
+      covariance(ii, jj) = truth->Evaluate(points->at(ii), points->at(jj));
+
+    covariance(ii, ii) += kNoiseVariance;
+    samples(ii) = normal(rng);
+  }
+
+  const VectorXd targets = covariance.llt().matrixL() * samples;
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 1.0));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  NewtonOptions options;
+  LearningSummary summary;
+  ASSERT_TRUE(gp.LearnHyperparams(options, &summary));
+  EXPECT_TRUE(summary.success);
+  EXPECT_LT(summary.num_iterations, options.max_iterations);
+  EXPECT_LT(summary.final_cost, summary.initial_cost);
+
+  // Gradient (relative to the parameters) should vanish.
+  const VectorXd params = kernel->ImmutableParams();
+  const TrainingLogLikelihood cost(
+    points, &targets, kernel->Clone(), kNoiseVariance);
+  double final_cost;
+  VectorXd gradient(kDimension);
+  cost.Evaluate(params.data(), &final_cost, gradient.data());
+  EXPECT_NEAR(final_cost, summary.final_cost,
+              kMaxError * std::abs(final_cost));
+  EXPECT_LE(gradient.cwiseProduct(params).cwiseAbs().maxCoeff(), kMaxGradient);
+
+  // GP must be consistent with its kernel.
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  const VectorXd& expected_regressed = expected.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+}
+
+// Check that pruning irrelevant dimensions leaves predictions unchanged, and
+// that full-dimensional queries and points are projected.
+TEST(GaussianProcess, TestPruneDimensions) {
+  const size_t kDimension = 4;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 100;
+  const double kNoiseVariance = 1e-3;
+  const double kMaxError = 1e-6;
+
+  // Dimensions 1 and 3 have huge length scales, so they barely matter.
+  const VectorXd lengths =
+    (VectorXd(kDimension) << 0.5, 1e6, 0.7, 1e5).finished();
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(3.0 * points->back()(0)) * points->back()(2);
+  }
+
+  // Reference GP on its own copy of the points.
+  const PointSet reference_points(new std::vector<VectorXd>(*points));
+  GaussianProcess reference(RbfKernel::Create(lengths), kNoiseVariance,
+                            reference_points, targets, 2 * kNumTrainingPoints);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     2 * kNumTrainingPoints);
+  EXPECT_EQ(gp.PruneDimensions(), 2);
+  EXPECT_EQ(gp.PruneDimensions(), 0);
+
+  // Kernel and points are compacted in place.
+  ASSERT_EQ(gp.RelevantDimensions().size(), 2);
+  EXPECT_EQ(gp.RelevantDimensions()[0], 0);
+  EXPECT_EQ(gp.RelevantDimensions()[1], 2);
+  EXPECT_EQ(gp.Dimension(), kDimension);
+  EXPECT_EQ(kernel->ImmutableParams().size(), 2);
+  EXPECT_EQ(points->at(0).size(), 2);
+
+  // Add the same full-dimensional point to both, and then a batch of them
+  // from a buffer.
+  const VectorXd x = VectorXd::Random(kDimension);
+  EXPECT_TRUE(gp.Add(x, 1.0));
+  EXPECT_TRUE(reference.Add(x, 1.0));
+
+  const MatrixXd batch = MatrixXd::Random(kDimension, 5);
+  const VectorXd batch_targets = VectorXd::Random(5);
+  EXPECT_TRUE(gp.Add(batch, batch_targets));
+  EXPECT_TRUE(reference.Add(batch, batch_targets));
+  EXPECT_EQ(points->back().size(), 2);
+
+  // Predictions at full-dimensional queries should match.
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd query = VectorXd::Random(kDimension);
+
+    double mean, variance, expected_mean, expected_variance;
+    gp.Evaluate(query, mean, variance);
+    reference.Evaluate(query, expected_mean, expected_variance);
+
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, expected_variance, kMaxError);
+  }
+}
+
 } //\namespace test
 } //\namespace gp
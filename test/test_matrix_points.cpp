@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for building and growing a GP from points stored in matrices.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that a GP built and grown from copies of raw strided arrays matches
+// one built from a point set.
+TEST(GaussianProcess, TestCopyPointsFromMatrices) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 60;
+  const size_t kNumInitialPoints = 40;
+  const size_t kStride = 3;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-12;
+
+  // Points one per column, with padding between columns, and targets.
+  std::vector<double> point_buffer(kStride * kNumTrainingPoints);
+  std::vector<double> target_buffer(kNumTrainingPoints);
+  for (size_t ii = 0; ii < point_buffer.size(); ii++)
+    point_buffer[ii] = std::sin(static_cast<double>(ii));
+  for (size_t ii = 0; ii < target_buffer.size(); ii++)
+    target_buffer[ii] = std::cos(static_cast<double>(ii));
+
+  typedef Eigen::Map<const MatrixXd, 0, Eigen::OuterStride<> > PointMap;
+  const PointMap points(point_buffer.data(), kDimension, kNumTrainingPoints,
+                        Eigen::OuterStride<>(kStride));
+  const Eigen::Map<const VectorXd> targets(target_buffer.data(),
+                                           kNumTrainingPoints);
+
+  // Build from the first points, then add the rest.
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance,
+                     points.leftCols(kNumInitialPoints),
+                     targets.head(kNumInitialPoints), kNumTrainingPoints);
+  EXPECT_TRUE(gp.Add(points.rightCols(kNumTrainingPoints - kNumInitialPoints),
+                     targets.tail(kNumTrainingPoints - kNumInitialPoints)));
+  EXPECT_FALSE(gp.Add(points.leftCols(1), targets.head(1)));
+  ASSERT_EQ(gp.ImmutablePoints()->size(), kNumTrainingPoints);
+
+  // Compare against a GP built from a point set.
+  PointSet point_set(new std::vector<VectorXd>);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    point_set->push_back(points.col(ii));
+
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, point_set,
+                           targets, kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+    EXPECT_TRUE(gp.ImmutablePoints()->at(ii) == point_set->at(ii));
+
+  const VectorXd& expected_regressed = expected.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+}
+
+} //\namespace test
+} //\namespace gp
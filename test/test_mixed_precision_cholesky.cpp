@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for MixedPrecisionCholesky, and for mixed precision
+// factorization in a GP and its log-likelihood.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/mixed_precision_cholesky.hpp>
+#include <utils/packed_symmetric_matrix.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  // RBF covariance of random points in the unit box, plus noise.
+  void RandomCovariance(size_t num_points, double length, double noise,
+                        PackedSymmetricMatrix& covariance) {
+    const Kernel::Ptr kernel =
+      RbfKernel::Create(VectorXd::Constant(2, length));
+
+    std::vector<VectorXd> points;
+    for (size_t ii = 0; ii < num_points; ii++)
+      points.push_back(VectorXd::Random(2));
+
+    covariance.Resize(num_points);
+    for (size_t ii = 0; ii < num_points; ii++) {
+      for (size_t jj = 0; jj <= ii; jj++)
+        covariance(ii, jj) = kernel->Evaluate(points[ii], points[jj]);
+
+      covariance(ii, ii) += noise;
+    }
+  }
+} //\namespace
+
+// Check that refinement recovers double precision solutions of a well
+// conditioned system without falling back, that the log determinant is as
+// accurate as documented, and that computing the double precision factor does
+// not switch solves over to it.
+TEST(MixedPrecisionCholesky, TestRefinement) {
+  const size_t kNumPoints = 200;
+  const size_t kNumRhs = 3;
+  const double kMaxError = 1e-10;
+  const double kMaxRelativeLogDetError = 1e-5;
+
+  PackedSymmetricMatrix covariance;
+  RandomCovariance(kNumPoints, 0.3, 1e-1, covariance);
+
+  MixedPrecisionCholesky cholesky;
+  cholesky.Compute(covariance);
+  ASSERT_EQ(cholesky.Info(), Eigen::Success);
+  EXPECT_FALSE(cholesky.UsingDouble());
+
+  const MatrixXd dense = covariance.Dense();
+  const Eigen::LLT<MatrixXd> llt(dense);
+
+  RefinementSummary summary;
+  const MatrixXd b = MatrixXd::Random(kNumPoints, kNumRhs);
+  const MatrixXd x = cholesky.Solve(b, &summary);
+  const MatrixXd expected = llt.solve(b);
+
+  EXPECT_FALSE(summary.fallback);
+  EXPECT_GE(summary.num_iterations, 1);
+  EXPECT_LE(summary.residual, RefinementOptions().tolerance);
+  EXPECT_LE((x - expected).cwiseAbs().maxCoeff(),
+            kMaxError * expected.cwiseAbs().maxCoeff());
+
+  const double expected_logdet =
+    2.0 * llt.matrixLLT().diagonal().array().log().sum();
+  EXPECT_NEAR(cholesky.LogDeterminant(), expected_logdet,
+              kMaxRelativeLogDetError * std::abs(expected_logdet));
+
+  const Eigen::LLT<MatrixXd>& double_llt = cholesky.DoubleFactorization();
+  EXPECT_LE((double_llt.matrixLLT() - llt.matrixLLT())
+            .triangularView<Eigen::Lower>().toDenseMatrix()
+            .cwiseAbs().maxCoeff(), kMaxError);
+  EXPECT_FALSE(cholesky.UsingDouble());
+
+  cholesky.Solve(b, &summary);
+  EXPECT_FALSE(summary.fallback);
+  EXPECT_GE(summary.num_iterations, 1);
+}
+
+// Check that a system too ill-conditioned for single precision is solved in
+// double precision instead.
+TEST(MixedPrecisionCholesky, TestFallback) {
+  const size_t kNumPoints = 200;
+  const double kMaxError = 1e-6;
+
+  PackedSymmetricMatrix covariance;
+  RandomCovariance(kNumPoints, 0.5, 1e-8, covariance);
+
+  MixedPrecisionCholesky cholesky;
+  cholesky.Compute(covariance);
+  ASSERT_EQ(cholesky.Info(), Eigen::Success);
+
+  RefinementSummary summary;
+  const VectorXd b = VectorXd::Random(kNumPoints);
+  const VectorXd x = cholesky.Solve(b, &summary);
+  EXPECT_TRUE(summary.fallback);
+  EXPECT_TRUE(cholesky.UsingDouble());
+
+  const VectorXd expected = Eigen::LLT<MatrixXd>(covariance.Dense()).solve(b);
+  EXPECT_LE((x - expected).cwiseAbs().maxCoeff(),
+            kMaxError * expected.cwiseAbs().maxCoeff());
+}
+
+// Check that a GP in mixed precision makes the same predictions, and has the
+// same log-likelihood and gradient, as one in double precision.
+TEST(GaussianProcess, TestMixedPrecision) {
+  const size_t kNumTrainingPoints = 150;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-9;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(2));
+    targets(ii) = std::sin(3.0 * points->back()(0)) + 0.1 * unif(rng);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(2, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+  GaussianProcess mixed(kernel->Clone(), kNoiseVariance, points, targets,
+                        kNumTrainingPoints);
+  mixed.EnableMixedPrecision();
+  EXPECT_TRUE(mixed.MixedPrecision());
+
+  const VectorXd& expected_regressed = gp.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             mixed.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+
+  const RefinementSummary summary = mixed.MixedPrecisionSummary();
+  EXPECT_FALSE(summary.fallback);
+  EXPECT_LE(summary.residual, RefinementOptions().tolerance);
+
+  double mean, variance, expected_mean, expected_variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Random(2);
+    gp.Evaluate(x, expected_mean, expected_variance);
+    mixed.Evaluate(x, mean, variance);
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, expected_variance, kMaxError);
+  }
+
+  // Log-likelihood and gradient.
+  const RefinementOptions refinement;
+  const TrainingLogLikelihood cost(points, &targets, kernel->Clone(),
+                                   kNoiseVariance);
+  const TrainingLogLikelihood mixed_cost(points, &targets, kernel->Clone(),
+                                         kNoiseVariance, &refinement);
+
+  const VectorXd params = kernel->ImmutableParams();
+  double expected_value, value;
+  VectorXd expected_gradient(params.size()), gradient(params.size());
+  ASSERT_TRUE(cost.Evaluate(params.data(), &expected_value,
+                            expected_gradient.data()));
+  ASSERT_TRUE(mixed_cost.Evaluate(params.data(), &value, gradient.data()));
+  EXPECT_NEAR(value, expected_value, 1e-4 * std::abs(expected_value));
+  EXPECT_LE((gradient - expected_gradient).cwiseAbs().maxCoeff(),
+            1e-6 * expected_gradient.cwiseAbs().maxCoeff());
+}
+
+} //\namespace test
+} //\namespace gp
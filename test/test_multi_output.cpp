@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for GPs with several outputs over the same training points.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that every output of a multi-output GP, including points added
+// afterward, predicts the same as a single-output GP with those targets.
+TEST(GaussianProcess, TestMultiOutputMatchesSingleOutputs) {
+  const size_t kDimension = 2;
+  const size_t kNumOutputs = 4;
+  const size_t kNumTrainingPoints = 40;
+  const size_t kNumAddedPoints = 10;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-8;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  const size_t kTotalPoints = kNumTrainingPoints + kNumAddedPoints;
+  std::vector<VectorXd> all_points;
+  MatrixXd targets(kTotalPoints, kNumOutputs);
+  for (size_t ii = 0; ii < kTotalPoints; ii++) {
+    all_points.push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+    for (size_t jj = 0; jj < kNumOutputs; jj++)
+      targets(ii, jj) = std::sin((jj + 1.0) * all_points.back().sum());
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  PointSet points(new std::vector<VectorXd>(
+    all_points.begin(), all_points.begin() + kNumTrainingPoints));
+  GaussianProcess gp(kernel, kNoiseVariance, points,
+                     VectorXd(targets.col(0).head(kNumTrainingPoints)),
+                     kTotalPoints);
+  gp.SetTargets(targets.topRows(kNumTrainingPoints));
+  EXPECT_EQ(gp.NumOutputs(), kNumOutputs);
+
+  for (size_t ii = kNumTrainingPoints; ii < kTotalPoints; ii++) {
+    const VectorXd row = targets.row(ii);
+    EXPECT_TRUE(gp.Add(all_points[ii],
+                       std::vector<double>(row.data(), row.data() + row.size())));
+  }
+
+  EXPECT_TRUE(gp.OutputTargets().isApprox(targets));
+
+  // One single-output GP per output.
+  std::vector< std::unique_ptr<GaussianProcess> > singles;
+  for (size_t jj = 0; jj < kNumOutputs; jj++) {
+    PointSet copy(new std::vector<VectorXd>(all_points));
+    singles.emplace_back(new GaussianProcess(
+      kernel->Clone(), kNoiseVariance, copy, VectorXd(targets.col(jj)),
+      kTotalPoints));
+  }
+
+  VectorXd means;
+  double variance, single_mean, single_variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+        return unif(rng); });
+    gp.Evaluate(x, means, variance);
+    ASSERT_EQ(means.size(), kNumOutputs);
+
+    for (size_t jj = 0; jj < kNumOutputs; jj++) {
+      singles[jj]->Evaluate(x, single_mean, single_variance);
+      EXPECT_NEAR(means(jj), single_mean, kMaxError);
+      EXPECT_NEAR(variance, single_variance, kMaxError);
+    }
+  }
+}
+
+// Check that the multi-output log-likelihood and its gradient are the sums
+// over outputs of the single-output ones, up to the shared log barrier.
+TEST(TrainingLogLikelihood, TestMultiOutputSum) {
+  const size_t kDimension = 2;
+  const size_t kNumOutputs = 3;
+  const size_t kNumTrainingPoints = 30;
+  const double kNoiseVariance = 1e-1;
+  const double kMaxError = 1e-6;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  MatrixXd targets(kNumTrainingPoints, kNumOutputs);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+    for (size_t jj = 0; jj < kNumOutputs; jj++)
+      targets(ii, jj) = std::cos((jj + 1.0) * points->back().sum());
+  }
+
+  const VectorXd params = VectorXd::Constant(kDimension, 0.7);
+  const TrainingLogLikelihood cost(
+    points, targets, RbfKernel::Create(params), kNoiseVariance);
+
+  double multi_cost;
+  VectorXd multi_gradient(kDimension);
+  ASSERT_TRUE(cost.Evaluate(params.data(), &multi_cost,
+                            multi_gradient.data()));
+
+  // The log barrier is included once per evaluation.
+  double barrier = 0.0;
+  VectorXd barrier_gradient(kDimension);
+  for (size_t ii = 0; ii < kDimension; ii++) {
+    barrier -= std::log(1e3 * params(ii));
+    barrier_gradient(ii) = -1.0 / params(ii);
+  }
+
+  double sum_cost = 0.0;
+  VectorXd sum_gradient = VectorXd::Zero(kDimension);
+  for (size_t jj = 0; jj < kNumOutputs; jj++) {
+    const VectorXd output = targets.col(jj);
+    const TrainingLogLikelihood single(
+      points, &output, RbfKernel::Create(params), kNoiseVariance);
+
+    double single_cost;
+    VectorXd single_gradient(kDimension);
+    ASSERT_TRUE(single.Evaluate(params.data(), &single_cost,
+                                single_gradient.data()));
+    sum_cost += single_cost - barrier;
+    sum_gradient += single_gradient - barrier_gradient;
+  }
+
+  EXPECT_NEAR(multi_cost, sum_cost + barrier, kMaxError);
+  for (size_t ii = 0; ii < kDimension; ii++)
+    EXPECT_NEAR(multi_gradient(ii), sum_gradient(ii) + barrier_gradient(ii),
+                kMaxError);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for the MultiTaskProcess class.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <optimization/cost_functors.hpp>
+#include <process/multi_task_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  const size_t kDimension = 2;
+  const size_t kNumTasks = 3;
+  const size_t kNumTrainingPoints = 30;
+  const size_t kNumTestPoints = 10;
+  const double kNoiseVariance = 1e-2;
+
+  // Random training points, correlated targets, and a task covariance.
+  void MakeProblem(std::default_random_engine& rng, PointSet& points,
+                   MatrixXd& targets, MatrixXd& task_covariance) {
+    std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+    points.reset(new std::vector<VectorXd>);
+    targets.resize(kNumTrainingPoints, kNumTasks);
+    for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+      points->push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+            return unif(rng); }));
+      for (size_t jj = 0; jj < kNumTasks; jj++)
+        targets(ii, jj) = std::sin(points->back().sum() + 0.3 * jj);
+    }
+
+    const MatrixXd factor = MatrixXd::NullaryExpr(
+      kNumTasks, kNumTasks, [&](Eigen::Index, Eigen::Index) {
+        return unif(rng); });
+    task_covariance = factor * factor.transpose() +
+      0.1 * MatrixXd::Identity(kNumTasks, kNumTasks);
+  }
+
+  // Check a MultiTaskProcess against a dense solve with the full covariance
+  // B (x) K + noise * I, restricted to the observed targets.
+  void CheckAgainstDense(const MultiTaskProcess& process,
+                         std::default_random_engine& rng, double max_error) {
+    std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+    const Kernel::ConstPtr kernel = process.ImmutableKernel();
+    const MatrixXd& task_covariance = process.ImmutableTaskCovariance();
+    const MatrixXd& targets = process.ImmutableTargets();
+    const size_t N = process.NumPoints();
+    const size_t T = process.NumTasks();
+    const ConstPointSet points = process.ImmutablePoints();
+
+    MatrixXd covariance(N, N);
+    for (size_t ii = 0; ii < N; ii++)
+      for (size_t jj = 0; jj < N; jj++)
+        covariance(ii, jj) = kernel->Evaluate(points->at(ii), points->at(jj));
+
+    std::vector<Eigen::Index> observed;
+    for (Eigen::Index ii = 0; ii < targets.size(); ii++) {
+      if (!std::isnan(targets(ii)))
+        observed.push_back(ii);
+    }
+
+    const size_t M = observed.size();
+    MatrixXd full(M, M);
+    VectorXd y(M);
+    for (size_t ii = 0; ii < M; ii++) {
+      y(ii) = targets(observed[ii]);
+      for (size_t jj = 0; jj < M; jj++) {
+        full(ii, jj) =
+          task_covariance(observed[ii] / N, observed[jj] / N) *
+          covariance(observed[ii] % N, observed[jj] % N);
+      }
+      full(ii, ii) += process.Noise();
+    }
+
+    const Eigen::LLT<MatrixXd> llt(full);
+    const VectorXd regressed = llt.solve(y);
+
+    VectorXd means, variances;
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      const VectorXd x = VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); });
+      process.Evaluate(x, means, variances);
+      ASSERT_EQ(means.size(), T);
+      ASSERT_EQ(variances.size(), T);
+
+      for (size_t tt = 0; tt < T; tt++) {
+        VectorXd cross(M);
+        for (size_t jj = 0; jj < M; jj++) {
+          cross(jj) = task_covariance(tt, observed[jj] / N) *
+            kernel->Evaluate(x, points->at(observed[jj] % N));
+        }
+
+        const double variance = task_covariance(tt, tt) *
+          kernel->Evaluate(x, x) - cross.dot(llt.solve(cross));
+        EXPECT_NEAR(means(tt), cross.dot(regressed), max_error);
+        EXPECT_NEAR(variances(tt), variance, max_error);
+      }
+    }
+  }
+} //\namespace
+
+// Check that the Kronecker solve matches a dense solve.
+TEST(MultiTaskProcess, TestFullyObservedMatchesDense) {
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+
+  PointSet points;
+  MatrixXd targets, task_covariance;
+  MakeProblem(rng, points, targets, task_covariance);
+
+  const MultiTaskProcess process(
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5)),
+    task_covariance, kNoiseVariance, points, targets);
+  EXPECT_TRUE(process.FullyObserved());
+
+  CheckAgainstDense(process, rng, 1e-6);
+}
+
+// Check that conjugate gradients with missing targets match a dense solve
+// over the observed targets.
+TEST(MultiTaskProcess, TestMissingTargetsMatchDense) {
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_int_distribution<size_t> point(0, kNumTrainingPoints - 1);
+  std::uniform_int_distribution<size_t> task(0, kNumTasks - 1);
+
+  PointSet points;
+  MatrixXd targets, task_covariance;
+  MakeProblem(rng, points, targets, task_covariance);
+  for (size_t ii = 0; ii < kNumTrainingPoints / 2; ii++)
+    targets(point(rng), task(rng)) = std::numeric_limits<double>::quiet_NaN();
+
+  const MultiTaskProcess process(
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5)),
+    task_covariance, kNoiseVariance, points, targets);
+  EXPECT_FALSE(process.FullyObserved());
+
+  CheckAgainstDense(process, rng, 1e-6);
+}
+
+// Check the gradient of the log-likelihood against finite differences, and
+// that learning does not increase it.
+TEST(MultiTaskProcess, TestLearnHyperparams) {
+  const double kEpsilon = 1e-6;
+  const double kMaxError = 1e-3;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+
+  PointSet points;
+  MatrixXd targets, task_covariance;
+  MakeProblem(rng, points, targets, task_covariance);
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  const MultiTaskLogLikelihood cost(points, targets, kernel->Clone(),
+                                    kNoiseVariance);
+  const VectorXd parameters = cost.Pack(task_covariance);
+  ASSERT_EQ(parameters.size(), cost.NumParameters());
+
+  double value;
+  VectorXd gradient(parameters.size());
+  ASSERT_TRUE(cost.Evaluate(parameters.data(), &value, gradient.data()));
+
+  for (Eigen::Index ii = 0; ii < parameters.size(); ii++) {
+    VectorXd forward = parameters, backward = parameters;
+    forward(ii) += kEpsilon;
+    backward(ii) -= kEpsilon;
+
+    double forward_value, backward_value;
+    cost.Evaluate(forward.data(), &forward_value, NULL);
+    cost.Evaluate(backward.data(), &backward_value, NULL);
+
+    const double numerical =
+      0.5 * (forward_value - backward_value) / kEpsilon;
+    EXPECT_NEAR(gradient(ii), numerical,
+                kMaxError * std::max(1.0, std::abs(numerical)));
+  }
+
+  // Learn, and compare costs at the initial and learned parameters.
+  MultiTaskProcess process(kernel, task_covariance, kNoiseVariance,
+                           points, targets);
+  ASSERT_TRUE(process.LearnHyperparams());
+
+  const MultiTaskLogLikelihood learned_cost(points, targets, kernel->Clone(),
+                                            kNoiseVariance);
+  const VectorXd learned =
+    learned_cost.Pack(process.ImmutableTaskCovariance());
+  double learned_value;
+  ASSERT_TRUE(learned_cost.Evaluate(learned.data(), &learned_value, NULL));
+  EXPECT_LE(learned_value, value);
+
+  CheckAgainstDense(process, rng, 1e-6);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for NoiseSweep, and for learning the noise variance of a GP.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/noise_sweep.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+namespace {
+  // Draw points uniformly from [0, 1]^d and targets from the GP prior, plus
+  // noise with the given variance.
+  void SamplePrior(const Kernel::Ptr& kernel, double noise, size_t dimension,
+                   size_t num_points, PointSet& points, VectorXd& targets) {
+    std::random_device rd;
+    std::default_random_engine rng(rd());
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    points.reset(new std::vector<VectorXd>);
+    for (size_t ii = 0; ii < num_points; ii++) {
+      VectorXd x(dimension);
+      for (size_t jj = 0; jj < dimension; jj++)
+        x(jj) = unif(rng);
+
+      points->push_back(x);
+    }
+
+    MatrixXd covariance(num_points, num_points);
+    for (size_t ii = 0; ii < num_points; ii++) {
+      for (size_t jj = 0; jj < num_points; jj++)
+        covariance(ii, jj) = kernel->Evaluate(points->at(ii), points->at(jj));
+
+      covariance(ii, ii) += 1e-8;
+    }
+
+    VectorXd samples(num_points);
+    for (size_t ii = 0; ii < num_points; ii++)
+      samples(ii) = normal(rng);
+
+    targets = covariance.llt().matrixL() * samples;
+    for (size_t ii = 0; ii < num_points; ii++)
+      targets(ii) += std::sqrt(noise) * normal(rng);
+  }
+} //\namespace
+
+// Check that the sweep agrees with a GP factorized at each noise variance.
+TEST(NoiseSweep, TestMatchesGaussianProcess) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 10;
+  const double kMaxError = 1e-6;
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.3));
+  PointSet points;
+  VectorXd targets;
+  SamplePrior(kernel, 1e-2, kDimension, kNumTrainingPoints, points, targets);
+
+  const NoiseSweep sweep(kernel, points, targets);
+  EXPECT_EQ(sweep.NumPoints(), kNumTrainingPoints);
+
+  const VectorXd noises = (VectorXd(3) << 1e-3, 1e-2, 1e-1).finished();
+  std::vector<VectorXd> test_points;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++)
+    test_points.push_back(
+      0.5 * (VectorXd::Random(kDimension).array() + 1.0).matrix());
+
+  for (size_t ii = 0; ii < noises.size(); ii++) {
+    GaussianProcess gp(kernel, noises(ii), points, targets, kNumTrainingPoints);
+
+    // Cost.
+    const Eigen::LLT<MatrixXd>& llt = gp.ImmutableCholesky();
+    const double expected_cost = targets.dot(gp.ImmutableRegressedTargets()) +
+      2.0 * llt.matrixLLT().diagonal().array().log().sum();
+    EXPECT_NEAR(sweep.Cost(noises(ii)), expected_cost,
+                kMaxError * std::abs(expected_cost));
+
+    // Regressed targets.
+    VectorXd regressed;
+    sweep.RegressedTargets(noises(ii), regressed);
+    const VectorXd& expected_regressed = gp.ImmutableRegressedTargets();
+    EXPECT_LE((regressed - expected_regressed).cwiseAbs().maxCoeff(),
+              kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+
+    // Predictions, one noise variance at a time and all at once.
+    for (size_t jj = 0; jj < kNumTestPoints; jj++) {
+      double mean, variance, expected_mean, expected_variance;
+      gp.Evaluate(test_points[jj], expected_mean, expected_variance);
+      sweep.Evaluate(test_points[jj], noises(ii), mean, variance);
+      EXPECT_NEAR(mean, expected_mean, kMaxError);
+      EXPECT_NEAR(variance, expected_variance, kMaxError);
+
+      VectorXd means, variances;
+      sweep.Evaluate(test_points[jj], noises, means, variances);
+      EXPECT_NEAR(means(ii), expected_mean, kMaxError);
+      EXPECT_NEAR(variances(ii), expected_variance, kMaxError);
+    }
+  }
+}
+
+// Check the cost derivative against a central difference.
+TEST(NoiseSweep, TestCostDerivative) {
+  const size_t kNumTrainingPoints = 50;
+  const double kDelta = 1e-7;
+  const double kMaxError = 1e-4;
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.2));
+  PointSet points;
+  VectorXd targets;
+  SamplePrior(kernel, 1e-2, 1, kNumTrainingPoints, points, targets);
+
+  const NoiseSweep sweep(kernel, points, targets);
+  for (double noise = 1e-3; noise < 1.0; noise *= 10.0) {
+    const double numerical = (sweep.Cost(noise + kDelta) -
+                              sweep.Cost(noise - kDelta)) / (2.0 * kDelta);
+    EXPECT_NEAR(sweep.CostDerivative(noise), numerical,
+                kMaxError * std::max(1.0, std::abs(numerical)));
+  }
+}
+
+// Check that learning the noise variance recovers the one the data was drawn
+// with, and leaves the GP consistent with it.
+TEST(GaussianProcess, TestLearnNoise) {
+  const size_t kNumTrainingPoints = 300;
+  const double kNoiseVariance = 1e-2;
+  const double kInitialNoiseVariance = 1e-4;
+  const double kMaxRelativeNoiseError = 0.5;
+  const double kMaxError = 1e-6;
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.2));
+  PointSet points;
+  VectorXd targets;
+  SamplePrior(kernel, kNoiseVariance, 1, kNumTrainingPoints, points, targets);
+
+  GaussianProcess gp(kernel, kInitialNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+  EXPECT_TRUE(gp.LearnNoise());
+  EXPECT_NEAR(gp.Noise(), kNoiseVariance,
+              kMaxRelativeNoiseError * kNoiseVariance);
+
+  // GP must be consistent with its noise variance.
+  GaussianProcess expected(kernel->Clone(), gp.Noise(), points, targets,
+                           kNumTrainingPoints);
+  const VectorXd& expected_regressed = expected.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+}
+
+// Learn kernel parameters and noise variance together, starting from an
+// overly smooth kernel and too little noise, and check that the noise variance
+// is recovered and that the kernel parameters were optimized at it.
+TEST(GaussianProcess, TestLearnHyperparamsWithNoise) {
+  const size_t kNumTrainingPoints = 300;
+  const double kNoiseVariance = 1e-2;
+  const double kInitialNoiseVariance = 1e-4;
+  const double kMaxRelativeNoiseError = 0.5;
+  const double kMaxImprovement = 1e-2;
+  const double kMaxError = 1e-6;
+
+  PointSet points;
+  VectorXd targets;
+  SamplePrior(RbfKernel::Create(VectorXd::Constant(1, 0.2)), kNoiseVariance,
+              1, kNumTrainingPoints, points, targets);
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.5));
+  GaussianProcess gp(kernel, kInitialNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  LearningOptions options;
+  options.learn_noise = true;
+  EXPECT_TRUE(gp.LearnHyperparams(options));
+  EXPECT_NEAR(gp.Noise(), kNoiseVariance,
+              kMaxRelativeNoiseError * kNoiseVariance);
+
+  // GP must be consistent with its kernel and noise variance.
+  GaussianProcess expected(kernel->Clone(), gp.Noise(), points, targets,
+                           kNumTrainingPoints);
+  const VectorXd& expected_regressed = expected.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             gp.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+
+  // Optimizing the kernel again at the learned noise variance barely helps.
+  LearningSummary summary;
+  EXPECT_TRUE(gp.LearnHyperparams(LearningOptions(), &summary));
+  EXPECT_LE(summary.LogLikelihoodImprovement(), kMaxImprovement);
+}
+
+} //\namespace test
+} //\namespace gp
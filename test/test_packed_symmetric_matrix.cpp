@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for PackedSymmetricMatrix, and for GP storage that grows with
+// the number of training points or drops the covariance altogether.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/packed_symmetric_matrix.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that growing the matrix keeps existing entries in place, and that the
+// dense view is symmetric.
+TEST(PackedSymmetricMatrix, TestGrowth) {
+  const size_t kSize = 20;
+
+  PackedSymmetricMatrix matrix;
+  for (size_t ii = 0; ii < kSize; ii++) {
+    matrix.Resize(ii + 1);
+    Eigen::Map<VectorXd> row = matrix.Row(ii);
+    for (size_t jj = 0; jj <= ii; jj++)
+      row(jj) = static_cast<double>(kSize * ii + jj);
+  }
+
+  EXPECT_EQ(matrix.Size(), kSize);
+  EXPECT_GE(matrix.Capacity(), kSize * (kSize + 1) / 2);
+
+  const MatrixXd dense = matrix.Dense();
+  for (size_t ii = 0; ii < kSize; ii++) {
+    for (size_t jj = 0; jj <= ii; jj++) {
+      EXPECT_EQ(dense(ii, jj), static_cast<double>(kSize * ii + jj));
+      EXPECT_EQ(dense(jj, ii), dense(ii, jj));
+      EXPECT_EQ(matrix(jj, ii), dense(ii, jj));
+    }
+  }
+
+  // Leading blocks carry over unchanged.
+  PackedSymmetricMatrix larger(kSize + 5);
+  larger.SetLeadingBlock(matrix);
+  const MatrixXd block = larger.Dense();
+  EXPECT_TRUE(block.topLeftCorner(kSize, kSize) == dense);
+}
+
+// Check that a GP with a large point limit only allocates for the points it
+// has, and that adding points one at a time matches building it at once.
+TEST(GaussianProcess, TestGrowableStorage) {
+  const size_t kNumSeedPoints = 5;
+  const size_t kNumTrainingPoints = 100;
+  const size_t kMaxPoints = 100000;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Constant(1, unif(rng)));
+    targets(ii) = unif(rng);
+  }
+
+  // Seed a GP with a few points and grow it.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, 0.5));
+  PointSet seed(new std::vector<VectorXd>(points->begin(),
+                                          points->begin() + kNumSeedPoints));
+  GaussianProcess gp(kernel, kNoiseVariance, seed,
+                     targets.head(kNumSeedPoints), kMaxPoints);
+  for (size_t ii = kNumSeedPoints; ii < kNumTrainingPoints; ii++)
+    EXPECT_TRUE(gp.Add(points->at(ii), targets(ii)));
+
+  const PackedSymmetricMatrix& covariance = gp.ImmutableCovariance();
+  EXPECT_EQ(covariance.Size(), kNumTrainingPoints);
+  EXPECT_LE(covariance.Capacity(), kNumTrainingPoints * kNumTrainingPoints);
+  EXPECT_LE(gp.ImmutableTargets().size(), 2 * kNumTrainingPoints);
+
+  // Compare against a GP built from all points at once.
+  GaussianProcess expected(kernel->Clone(), kNoiseVariance, points, targets,
+                           kNumTrainingPoints);
+  const VectorXd& expected_regressed = expected.ImmutableRegressedTargets();
+  EXPECT_LE((expected_regressed -
+             gp.ImmutableRegressedTargets().head(kNumTrainingPoints))
+            .cwiseAbs().maxCoeff(),
+            kMaxError * expected_regressed.cwiseAbs().maxCoeff());
+
+  double mean, variance, expected_mean, expected_variance;
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii += 10) {
+    gp.EvaluateTrainingPoint(ii, mean, variance);
+    expected.EvaluateTrainingPoint(ii, expected_mean, expected_variance);
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, expected_variance, kMaxError);
+  }
+}
+
+// Check that a GP which only keeps its Cholesky factor makes the same
+// predictions as one that also stores the covariance.
+TEST(GaussianProcess, TestCompactStorage) {
+  const size_t kNumSeedPoints = 20;
+  const size_t kNumTrainingPoints = 50;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-8;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(2));
+    targets(ii) = unif(rng);
+  }
+
+  // Seed both GPs with the same points, and make one of them compact.
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(2, 0.5));
+  PointSet seed(new std::vector<VectorXd>(points->begin(),
+                                          points->begin() + kNumSeedPoints));
+  PointSet compact_seed(new std::vector<VectorXd>(*seed));
+  GaussianProcess gp(kernel, kNoiseVariance, seed,
+                     targets.head(kNumSeedPoints), kNumTrainingPoints);
+  GaussianProcess compact(kernel->Clone(), kNoiseVariance, compact_seed,
+                          targets.head(kNumSeedPoints), kNumTrainingPoints);
+  compact.EnableCompactStorage();
+  EXPECT_TRUE(compact.CompactStorage());
+  EXPECT_EQ(compact.ImmutableCovariance().Size(), 0);
+
+  for (size_t ii = kNumSeedPoints; ii < kNumTrainingPoints; ii++) {
+    EXPECT_TRUE(gp.Add(points->at(ii), targets(ii)));
+    EXPECT_TRUE(compact.Add(points->at(ii), targets(ii)));
+  }
+
+  EXPECT_EQ(compact.ImmutableCovariance().Size(), 0);
+
+  double mean, variance, expected_mean, expected_variance;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Random(2);
+    gp.Evaluate(x, expected_mean, expected_variance);
+    compact.Evaluate(x, mean, variance);
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, expected_variance, kMaxError);
+  }
+
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii += 5) {
+    gp.EvaluateTrainingPoint(ii, expected_mean, expected_variance);
+    compact.EvaluateTrainingPoint(ii, mean, variance);
+    EXPECT_NEAR(mean, expected_mean, kMaxError);
+    EXPECT_NEAR(variance, expected_variance, kMaxError);
+  }
+
+  // Changing the noise refactorizes from the kernel.
+  EXPECT_TRUE(gp.SetNoise(2.0 * kNoiseVariance));
+  EXPECT_TRUE(compact.SetNoise(2.0 * kNoiseVariance));
+  EXPECT_LE((gp.ImmutableRegressedTargets() -
+             compact.ImmutableRegressedTargets()).cwiseAbs().maxCoeff(),
+            kMaxError * gp.ImmutableRegressedTargets().cwiseAbs().maxCoeff());
+
+  // Turning compact storage off brings the covariance back.
+  compact.DisableCompactStorage();
+  EXPECT_EQ(compact.ImmutableCovariance().Size(), kNumTrainingPoints);
+  const MatrixXd expected_covariance = gp.ImmutableCovariance().Dense();
+  const MatrixXd covariance = compact.ImmutableCovariance().Dense();
+  EXPECT_LE((covariance - expected_covariance).cwiseAbs().maxCoeff(),
+            kMaxError);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for PredictionCache, and for caching predictions in a GP.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/prediction_cache.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that the least recently used entry is evicted, and that statistics
+// are kept.
+TEST(PredictionCache, TestEviction) {
+  const VectorXd a = VectorXd::Constant(2, 1.0);
+  const VectorXd b = VectorXd::Constant(2, 2.0);
+  const VectorXd c = VectorXd::Constant(2, 3.0);
+
+  PredictionCache cache(2);
+  cache.Insert(a, 0)->mean = 1.0;
+  cache.Insert(b, 0)->mean = 2.0;
+
+  // Touch 'a', so 'b' is evicted next.
+  ASSERT_TRUE(cache.Find(a, 0) != NULL);
+  EXPECT_EQ(cache.Find(a, 0)->mean, 1.0);
+  cache.Insert(c, 0)->mean = 3.0;
+
+  EXPECT_EQ(cache.Size(), 2);
+  EXPECT_TRUE(cache.Find(b, 0) == NULL);
+  EXPECT_TRUE(cache.Find(c, 0) != NULL);
+  EXPECT_TRUE(cache.Find(a, 0) != NULL);
+
+  const PredictionCache::Statistics& statistics = cache.ImmutableStatistics();
+  EXPECT_EQ(statistics.hits, 4);
+  EXPECT_EQ(statistics.misses, 1);
+  EXPECT_EQ(statistics.evictions, 1);
+  EXPECT_NEAR(statistics.HitRate(), 0.8, 1e-12);
+}
+
+// Check that entries from another model generation are dropped.
+TEST(PredictionCache, TestGenerations) {
+  const VectorXd a = VectorXd::Constant(3, 1.0);
+
+  PredictionCache cache(4);
+  cache.Insert(a, 0);
+  EXPECT_TRUE(cache.Find(a, 0) != NULL);
+  EXPECT_TRUE(cache.Find(a, 1) == NULL);
+  EXPECT_EQ(cache.Size(), 0);
+
+  // Re-inserting resets the entry.
+  cache.Insert(a, 1)->has_mean = true;
+  EXPECT_FALSE(cache.Insert(a, 1)->has_mean);
+  EXPECT_EQ(cache.Size(), 1);
+}
+
+// Check that a cached GP always agrees with an uncached one, and that points
+// queried repeatedly hit the cache.
+TEST(GaussianProcess, TestPredictionCache) {
+  const size_t kDimension = 2;
+  const size_t kNumTrainingPoints = 30;
+  const size_t kNumTestPoints = 20;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-10;
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::Random(kDimension));
+    targets(ii) = std::sin(points->back().sum());
+  }
+
+  const VectorXd lengths = VectorXd::Constant(kDimension, 0.5);
+  const PointSet reference_points(new std::vector<VectorXd>(*points));
+  GaussianProcess reference(RbfKernel::Create(lengths), kNoiseVariance,
+                            reference_points, targets, kNumTrainingPoints + 1);
+  GaussianProcess gp(RbfKernel::Create(lengths), kNoiseVariance,
+                     points, targets, kNumTrainingPoints + 1);
+  gp.EnablePredictionCache(kNumTestPoints);
+
+  std::vector<VectorXd> queries;
+  std::vector<double> query_targets;
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    queries.push_back(VectorXd::Random(kDimension));
+    query_targets.push_back(queries.back().prod());
+  }
+
+  auto expect_agreement = [&]() {
+    for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+      double mean, variance, expected_mean, expected_variance;
+      gp.Evaluate(queries[ii], mean, variance);
+      reference.Evaluate(queries[ii], expected_mean, expected_variance);
+
+      EXPECT_NEAR(mean, expected_mean, kMaxError);
+      EXPECT_NEAR(variance, expected_variance, kMaxError);
+    }
+  };
+
+  // Second pass should hit every time.
+  expect_agreement();
+  expect_agreement();
+  PredictionCache::Statistics statistics = gp.PredictionCacheStatistics();
+  EXPECT_EQ(statistics.misses, kNumTestPoints);
+  EXPECT_EQ(statistics.hits, kNumTestPoints);
+
+  // Updating targets keeps the cross covariances, but not the means.
+  EXPECT_NEAR(gp.UpdateTargets(queries, query_targets, 0.1),
+              reference.UpdateTargets(queries, query_targets, 0.1),
+              kMaxError);
+  expect_agreement();
+  statistics = gp.PredictionCacheStatistics();
+  EXPECT_EQ(statistics.misses, kNumTestPoints);
+  EXPECT_EQ(statistics.hits, 3 * kNumTestPoints);
+
+  // Changing the noise or adding a point invalidates everything.
+  EXPECT_TRUE(gp.SetNoise(2.0 * kNoiseVariance));
+  EXPECT_TRUE(reference.SetNoise(2.0 * kNoiseVariance));
+  expect_agreement();
+
+  EXPECT_TRUE(gp.Add(queries[0], query_targets[0]));
+  EXPECT_TRUE(reference.Add(queries[0], query_targets[0]));
+  expect_agreement();
+
+  statistics = gp.PredictionCacheStatistics();
+  EXPECT_EQ(statistics.misses, 3 * kNumTestPoints);
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for ScaledPointCache, and for GP covariances computed from
+// pre-scaled training points.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <kernels/scaled_point_cache.hpp>
+#include <process/gaussian_process.hpp>
+#include <utils/types.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that cached kernel values match direct evaluation as points are
+// appended, and that only changing the kernel parameters makes the cache stale.
+TEST(ScaledPointCache, TestMatchesKernel) {
+  const size_t kDimension = 4;
+  const size_t kNumPoints = 50;
+  const double kMaxError = 1e-12;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-3.0, 3.0);
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.7));
+  const VectorXd x = VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+      return unif(rng); });
+
+  ScaledPointCache cache;
+  std::vector<VectorXd> points;
+  VectorXd values, scaled;
+  for (size_t ii = 0; ii < kNumPoints; ii++) {
+    points.push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+    ASSERT_TRUE(cache.Update(*kernel, points));
+    ASSERT_TRUE(cache.Current(*kernel, points.size()));
+
+    values.resize(points.size());
+    cache.Evaluate(x, values, scaled);
+    for (size_t jj = 0; jj < points.size(); jj++)
+      EXPECT_NEAR(values(jj), kernel->Evaluate(points[jj], x), kMaxError);
+  }
+
+  // Setting the same parameters again leaves the cache current, while new
+  // ones invalidate it until the next update.
+  const VectorXd params = kernel->ImmutableParams();
+  kernel->SetParams(params.data());
+  EXPECT_TRUE(cache.Current(*kernel, points.size()));
+
+  kernel->Adjust(0.3, 1);
+  EXPECT_FALSE(cache.Current(*kernel, points.size()));
+
+  ASSERT_TRUE(cache.Update(*kernel, points));
+  cache.Evaluate(x, values, scaled);
+  for (size_t jj = 0; jj < points.size(); jj++)
+    EXPECT_NEAR(values(jj), kernel->Evaluate(points[jj], x), kMaxError);
+}
+
+// Check that a GP whose kernel has distance scales computes the same
+// covariance and predictions as one built from direct kernel evaluations,
+// including after its kernel parameters change.
+TEST(GaussianProcess, TestScaledCovariance) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 60;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxError = 1e-9;
+
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    points->push_back(VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+          return unif(rng); }));
+    targets(ii) = std::cos(points->back().sum());
+  }
+
+  const Kernel::Ptr kernel =
+    RbfKernel::Create(VectorXd::Constant(kDimension, 0.5));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  for (size_t trial = 0; trial < 2; trial++) {
+    const PackedSymmetricMatrix& covariance = gp.ImmutableCovariance();
+    for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+      for (size_t jj = 0; jj < ii; jj++) {
+        EXPECT_NEAR(covariance(ii, jj),
+                    kernel->Evaluate(points->at(ii), points->at(jj)),
+                    kMaxError);
+      }
+    }
+
+    const VectorXd x = VectorXd::NullaryExpr(kDimension, [&](Eigen::Index) {
+        return unif(rng); });
+    VectorXd cross(kNumTrainingPoints);
+    for (size_t ii = 0; ii < kNumTrainingPoints; ii++)
+      cross(ii) = kernel->Evaluate(points->at(ii), x);
+
+    double mean, variance;
+    gp.Evaluate(x, mean, variance);
+    EXPECT_NEAR(mean, cross.dot(gp.ImmutableRegressedTargets()), kMaxError);
+    EXPECT_NEAR(variance, 1.0 - cross.dot(gp.Solve(cross)), kMaxError);
+
+    // Change the length scales, as learning would.
+    kernel->Reset(VectorXd::Constant(kDimension, 0.8));
+    gp.SetNoise(kNoiseVariance);
+  }
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for ServingProcess, comparing single and double precision
+// snapshots of a GP against the GP itself.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <kernels/rbf_kernel.hpp>
+#include <process/gaussian_process.hpp>
+#include <process/serving_process.hpp>
+#include <utils/types.hpp>
+
+#include "test_functions.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <math.h>
+
+namespace gp {
+namespace test {
+
+// Check that double precision snapshots match the GP exactly, and that
+// single precision snapshots stay close to it on a 1D test function.
+TEST(ServingProcess, TestFunctionApprox1D) {
+  const size_t kNumTrainingPoints = 100;
+  const size_t kNumTestPoints = 100;
+  const double kNoiseVariance = 1e-2;
+  const double kLength = 0.1;
+  const double kMaxDoubleError = 1e-10;
+  const double kMaxFloatMeanError = 1e-3;
+  const double kMaxFloatVarianceError = 1e-2;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Train a GP on the test function.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    const double x = unif(rng);
+    points->push_back(VectorXd::Constant(1, x));
+    targets(ii) = BumpyParabola(x);
+  }
+
+  const Kernel::Ptr kernel = RbfKernel::Create(VectorXd::Constant(1, kLength));
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+
+  const ServingProcess<double>::ConstPtr exact = gp.Snapshot<double>();
+  const ServingProcess<float>::ConstPtr single = gp.Snapshot<float>();
+  EXPECT_EQ(exact->NumPoints(), kNumTrainingPoints);
+  EXPECT_EQ(single->NumPoints(), kNumTrainingPoints);
+
+  // Compare point by point, and as a batch.
+  std::vector<VectorXf> batch;
+  VectorXd expected_means(kNumTestPoints);
+  VectorXd expected_variances(kNumTestPoints);
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    const VectorXd x = VectorXd::Constant(1, unif(rng));
+    gp.Evaluate(x, expected_means(ii), expected_variances(ii));
+
+    double mean, variance;
+    exact->Evaluate(x, mean, variance);
+    EXPECT_NEAR(mean, expected_means(ii), kMaxDoubleError);
+    EXPECT_NEAR(variance, expected_variances(ii), kMaxDoubleError);
+
+    float single_mean, single_variance;
+    batch.push_back(x.cast<float>());
+    single->Evaluate(batch.back(), single_mean, single_variance);
+    EXPECT_NEAR(single_mean, expected_means(ii), kMaxFloatMeanError);
+    EXPECT_NEAR(single_variance, expected_variances(ii),
+                kMaxFloatVarianceError);
+  }
+
+  VectorXf means, variances;
+  single->Evaluate(batch, means, variances);
+  EXPECT_LE((means.cast<double>() - expected_means).cwiseAbs().maxCoeff(),
+            kMaxFloatMeanError);
+  EXPECT_LE((variances.cast<double>() -
+             expected_variances).cwiseAbs().maxCoeff(),
+            kMaxFloatVarianceError);
+}
+
+// Same, in several dimensions with one of them pruned, so that queries are
+// projected.
+TEST(ServingProcess, TestPrunedDimensions) {
+  const size_t kDimension = 3;
+  const size_t kNumTrainingPoints = 200;
+  const size_t kNumTestPoints = 50;
+  const double kNoiseVariance = 1e-2;
+  const double kMaxFloatMeanError = 1e-3;
+  const double kMaxFloatVarianceError = 1e-2;
+
+  // Random number generator.
+  std::random_device rd;
+  std::default_random_engine rng(rd());
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+  // Targets ignore the last dimension, whose length scale is huge.
+  PointSet points(new std::vector<VectorXd>);
+  VectorXd targets(kNumTrainingPoints);
+  for (size_t ii = 0; ii < kNumTrainingPoints; ii++) {
+    VectorXd x(kDimension);
+    for (size_t jj = 0; jj < kDimension; jj++)
+      x(jj) = unif(rng);
+
+    points->push_back(x);
+    targets(ii) = BumpyParabola(x(0)) + BumpyParabola(x(1));
+  }
+
+  VectorXd lengths = VectorXd::Constant(kDimension, 0.3);
+  lengths(kDimension - 1) = 1e6;
+  const Kernel::Ptr kernel = RbfKernel::Create(lengths);
+  GaussianProcess gp(kernel, kNoiseVariance, points, targets,
+                     kNumTrainingPoints);
+  ASSERT_EQ(gp.PruneDimensions(), 1);
+
+  const ServingProcess<float>::ConstPtr single = gp.Snapshot<float>();
+  EXPECT_EQ(single->Dimension(), kDimension);
+
+  for (size_t ii = 0; ii < kNumTestPoints; ii++) {
+    VectorXd x(kDimension);
+    for (size_t jj = 0; jj < kDimension; jj++)
+      x(jj) = unif(rng);
+
+    double expected_mean, expected_variance;
+    gp.Evaluate(x, expected_mean, expected_variance);
+
+    float mean, variance;
+    single->Evaluate(x.cast<float>(), mean, variance);
+    EXPECT_NEAR(mean, expected_mean, kMaxFloatMeanError);
+    EXPECT_NEAR(variance, expected_variance, kMaxFloatVarianceError);
+  }
+}
+
+} //\namespace test
+} //\namespace gp
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2017, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unit tests for ThreadPool.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <utils/thread_pool.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+
+namespace gp {
+namespace test {
+
+// Check that every iteration runs exactly once, over several loops on the
+// same pool.
+TEST(ThreadPool, TestParallelFor) {
+  const size_t kNumWorkers = 3;
+  const size_t kNumIterations = 1000;
+  const size_t kNumLoops = 20;
+
+  ThreadPool pool(kNumWorkers);
+  EXPECT_EQ(pool.NumThreads(), kNumWorkers + 1);
+
+  for (size_t ii = 0; ii < kNumLoops; ii++) {
+    std::vector<int> counts(kNumIterations, 0);
+    pool.ParallelFor(kNumIterations, [&](size_t jj) { counts[jj]++; });
+
+    for (size_t jj = 0; jj < kNumIterations; jj++)
+      EXPECT_EQ(counts[jj], 1);
+  }
+}
+
+// Check that a loop started from inside another loop runs on the calling
+// thread instead of waiting for the busy pool.
+TEST(ThreadPool, TestNestedParallelFor) {
+  const size_t kNumWorkers = 3;
+  const size_t kNumOuter = 8;
+  const size_t kNumInner = 100;
+
+  ThreadPool pool(kNumWorkers);
+  std::atomic<size_t> total(0);
+  pool.ParallelFor(kNumOuter, [&](size_t) {
+    pool.ParallelFor(kNumInner, [&](size_t) { total++; });
+  });
+
+  EXPECT_EQ(total.load(), kNumOuter * kNumInner);
+}
+
+} //\namespace test
+} //\namespace gp